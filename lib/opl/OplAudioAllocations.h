@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Heap allocations made on the audio thread (should stay 0).
+//
+// pullOutput and the output backends mark their thread while they run
+// (Scope), a replaced global operator new counts what is allocated inside:
+// the engine, the resampler, ymfm, the backend, anything.
+//
+// Replacing operator new is up to the program: OPL_AUDIO_ALLOCATION_COUNTER
+// in one translation unit per executable (the Composer with
+// OPL_COUNT_AUDIO_ALLOCATIONS in main.cpp, fmsbench). It also counts the
+// allocations of all threads (getTotalCount) for benchmarks.
+// Without it isCounting() is false and the counts stay 0.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace OplAudioAllocations {
+
+    inline thread_local bool tInAudioThread = false;
+    inline std::atomic<uint64_t> sCount = 0;
+    inline std::atomic<uint64_t> sTotalCount = 0;
+    inline std::atomic<bool> sCounting = false;
+
+    // from operator new
+    inline void record()
+    {
+        sTotalCount.fetch_add(1, std::memory_order_relaxed);
+        if (tInAudioThread)
+            sCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline uint64_t getCount() { return sCount.load(std::memory_order_relaxed); }
+    // every thread of the process
+    inline uint64_t getTotalCount() { return sTotalCount.load(std::memory_order_relaxed); }
+    inline bool isCounting() { return sCounting.load(std::memory_order_relaxed); }
+    inline bool enableCounting() { sCounting.store(true, std::memory_order_relaxed); return true; }
+
+    // marks the current thread as audio thread, nests
+    class Scope
+    {
+        bool mPrev;
+    public:
+        Scope() : mPrev(tInAudioThread) { tInAudioThread = true; }
+        ~Scope() { tInAudioThread = mPrev; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+} // namespace OplAudioAllocations
+
+// the deletes stay out of line: inlined into a caller GCC pairs the free
+// with the standard operator new (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define OPL_ALLOCATION_NOINLINE [[gnu::noinline]]
+#else
+#define OPL_ALLOCATION_NOINLINE
+#endif
+
+// the counting operator new / delete, see above
+#define OPL_AUDIO_ALLOCATION_COUNTER \
+    [[maybe_unused]] static const bool sOplAudioAllocationCounter = OplAudioAllocations::enableCounting(); \
+    void* operator new(std::size_t size) \
+    { \
+        OplAudioAllocations::record(); \
+        if (void* ptr = std::malloc(size ? size : 1)) \
+            return ptr; \
+        throw std::bad_alloc(); \
+    } \
+    void* operator new[](std::size_t size) \
+    { \
+        OplAudioAllocations::record(); \
+        if (void* ptr = std::malloc(size ? size : 1)) \
+            return ptr; \
+        throw std::bad_alloc(); \
+    } \
+    OPL_ALLOCATION_NOINLINE void operator delete(void* ptr) noexcept { std::free(ptr); } \
+    OPL_ALLOCATION_NOINLINE void operator delete[](void* ptr) noexcept { std::free(ptr); } \
+    OPL_ALLOCATION_NOINLINE void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); } \
+    OPL_ALLOCATION_NOINLINE void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
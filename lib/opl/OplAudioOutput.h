@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Output backend of a live OplController. The engine itself knows no audio
+// API: a backend opens the device and calls OplController::pullOutput from
+// its audio thread. OplSdlOutput is the SDL3 backend used by the editor.
+//
+//   controller->setAudioOutput(std::make_unique<OplSdlOutput>());
+//   controller->initController();
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+
+#include "OplOutputSpec.h"
+
+class OplController;
+
+class OplAudioOutput
+{
+public:
+    virtual ~OplAudioOutput() = default;
+
+    // rate and format the device prefers, false if unknown
+    virtual bool getDeviceSpec(OplOutputSpec& spec) const { (void)spec; return false; }
+    // frames the device pulls per callback, 0 if unknown (sizes the render block)
+    virtual uint32_t getBufferFrames() const { return 0; }
+
+    // starts pulling from controller.pullOutput in the given spec
+    virtual bool open(OplController& controller, const OplOutputSpec& spec) = 0;
+    // stops the audio thread, no pullOutput call after this returns
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    virtual float getVolume() const { return 0.f; }
+    virtual bool setVolume(float value) { (void)value; return false; }
+};
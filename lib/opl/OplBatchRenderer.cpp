@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplBatchRenderer.h"
+
+#include <chrono>
+
+//------------------------------------------------------------------------------
+static int64_t batchNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//------------------------------------------------------------------------------
+OplBatchRenderer::~OplBatchRenderer()
+{
+    cancel();
+    wait();
+}
+//------------------------------------------------------------------------------
+void OplBatchRenderer::addJob(const std::string& songFile, const std::string& wavFile)
+{
+    if (!mWorkers.empty())
+        return;
+    auto job = std::make_unique<Job>();
+    job->songFile = songFile;
+    job->wavFile = wavFile;
+    mJobs.push_back(std::move(job));
+}
+//------------------------------------------------------------------------------
+void OplBatchRenderer::clearJobs()
+{
+    if (!mWorkers.empty())
+        return;
+    mJobs.clear();
+}
+//------------------------------------------------------------------------------
+bool OplBatchRenderer::start(const Settings& settings)
+{
+    if (!mWorkers.empty() || mJobs.empty())
+        return false;
+
+    mSettings = settings;
+    mNextJob = 0;
+    mFinished = 0;
+    mCancel = false;
+    mEndNs = 0;
+    mStartNs = batchNowNs();
+
+    uint32_t threads = settings.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<uint32_t>(threads, (uint32_t)mJobs.size());
+
+    Log("INFO: Batch export of %u songs on %u threads", (uint32_t)mJobs.size(), threads);
+    for (uint32_t i = 0; i < threads; i++)
+        mWorkers.emplace_back(&OplBatchRenderer::workerLoop, this);
+    return true;
+}
+//------------------------------------------------------------------------------
+bool OplBatchRenderer::wait()
+{
+    const bool wasRunning = !mWorkers.empty();
+    for (std::thread& worker : mWorkers)
+        if (worker.joinable())
+            worker.join();
+    mWorkers.clear();
+
+    Stats stats = getStats();
+    if (wasRunning) {
+        Log("INFO: Batch export: %u done, %u failed, %.2f songs/s, %.0f samples/s",
+            stats.done, stats.failed, stats.songsPerSecond, stats.samplesPerSecond);
+    }
+    return stats.failed == 0;
+}
+//------------------------------------------------------------------------------
+void OplBatchRenderer::cancel()
+{
+    mCancel = true;
+}
+//------------------------------------------------------------------------------
+void OplBatchRenderer::workerLoop()
+{
+    while (true) {
+        uint32_t index = mNextJob.fetch_add(1);
+        if (index >= mJobs.size())
+            break;
+
+        Job& job = *mJobs[index];
+        if (mCancel) {
+            job.state = JobState::Cancelled;
+        } else {
+            job.state = JobState::Running;
+            job.state = renderJob(job) ? JobState::Done : JobState::Failed;
+        }
+
+        if (mFinished.fetch_add(1) + 1 == mJobs.size())
+            mEndNs = batchNowNs();
+    }
+}
+//------------------------------------------------------------------------------
+bool OplBatchRenderer::renderJob(Job& job)
+{
+    const int64_t start = batchNowNs();
+
+    // everything is private to this job: chip, sequencer and song
+    auto controller = std::make_unique<OplController>();
+    auto song = std::make_unique<OplController::SongDataFMS>();
+    song->init();
+
+    controller->setRenderMode(mSettings.renderMode);
+    controller->setTuning(mSettings.tuning);
+    if (!controller->setOutputSpec(mSettings.spec))
+        return false;
+
+    // loading resets the chip, the mode is set afterwards
+    if (!controller->loadSongFMS(job.songFile, *song))
+        return false;
+    controller->setMelodicMode(mSettings.melodicMode);
+
+    if (!controller->renderToWav(*song, job.wavFile, &job.progress))
+        return false;
+
+    job.progress.store(1.f, std::memory_order_relaxed);
+    job.frames = controller->getRenderedFrames();
+    job.seconds = (double)(batchNowNs() - start) / 1e9;
+    return true;
+}
+//------------------------------------------------------------------------------
+OplBatchRenderer::Stats OplBatchRenderer::getStats() const
+{
+    Stats stats;
+    stats.total = (uint32_t)mJobs.size();
+    for (const auto& job : mJobs) {
+        JobState state = job->state.load();
+        if (state == JobState::Done) {
+            stats.done++;
+            stats.frames += job->frames;
+        } else if (state == JobState::Failed || state == JobState::Cancelled) {
+            stats.failed++;
+        }
+    }
+
+    if (mStartNs == 0)
+        return stats;
+
+    int64_t end = mEndNs.load();
+    if (end == 0)
+        end = batchNowNs();
+    stats.elapsed = (double)(end - mStartNs) / 1e9;
+    if (stats.elapsed > 0.0) {
+        stats.songsPerSecond = (double)stats.done / stats.elapsed;
+        stats.samplesPerSecond = (double)stats.frames / stats.elapsed;
+    }
+    return stats;
+}
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Batch export of .fms songs to wav on a pool of worker threads.
+// Every worker renders one song at a time on its own offline OplController
+// (own chip, own sequencer), nothing is shared between the jobs.
+//
+//   OplBatchRenderer batch;
+//   batch.addJob("pascal/ADLIB/AXELF.FMS", "out/AXELF.wav");
+//   batch.start(settings);
+//   ... poll getJob(i).progress / getStats() ...
+//   batch.wait();
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OplController.h"
+
+class OplBatchRenderer
+{
+public:
+    struct Settings {
+        OplController::RenderMode renderMode = OplController::RenderMode::BLENDED;
+        OplOutputSpec spec;
+        bool melodicMode = true;
+        OplTuning tuning;     // see OplNoteTable
+        uint32_t threads = 0; // 0 = one per core
+    };
+
+    enum class JobState : uint8_t {
+        Pending,
+        Running,
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    struct Job {
+        std::string songFile;
+        std::string wavFile;
+        std::atomic<float> progress = 0.f;     // 0..1, written by the worker
+        std::atomic<JobState> state = JobState::Pending;
+        uint64_t frames = 0;                   // valid when Done
+        double seconds = 0.0;                  // render time, valid when Done
+    };
+
+    struct Stats {
+        uint32_t total = 0;
+        uint32_t done = 0;
+        uint32_t failed = 0;     // including cancelled
+        uint64_t frames = 0;          // stereo sample frames of the finished songs
+        double elapsed = 0.0;         // wall clock seconds since start
+        double songsPerSecond = 0.0;
+        double samplesPerSecond = 0.0; // frames per wall clock second
+    };
+
+private:
+    std::vector<std::unique_ptr<Job>> mJobs;
+    std::vector<std::thread> mWorkers;
+    std::atomic<uint32_t> mNextJob = 0;
+    std::atomic<uint32_t> mFinished = 0;
+    std::atomic<bool> mCancel = false;
+    Settings mSettings;
+    int64_t mStartNs = 0;
+    std::atomic<int64_t> mEndNs = 0;
+
+    void workerLoop();
+    bool renderJob(Job& job);
+
+public:
+    OplBatchRenderer() = default;
+    ~OplBatchRenderer();
+    OplBatchRenderer(const OplBatchRenderer&) = delete;
+    OplBatchRenderer& operator=(const OplBatchRenderer&) = delete;
+
+    // only before start
+    void addJob(const std::string& songFile, const std::string& wavFile);
+    void clearJobs();
+
+    // starts the workers and returns, false if running or nothing to do
+    bool start(const Settings& settings);
+    // blocks until all jobs are finished, returns true if none failed
+    bool wait();
+    // pending jobs are skipped, running songs are finished
+    void cancel();
+
+    bool isRunning() const { return !mWorkers.empty() && mFinished.load() < mJobs.size(); }
+    uint32_t getJobCount() const { return (uint32_t)mJobs.size(); }
+    const Job& getJob(uint32_t index) const { return *mJobs[index]; }
+    Stats getStats() const;
+};
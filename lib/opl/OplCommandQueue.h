@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Single producer / single consumer lock free queue between the GUI thread
+// (producer) and the thread rendering the chip (consumer).
+// Each command is stamped with the output frame it should be applied at.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+struct OplCommand {
+    enum class Type : uint8_t {
+        Write,          // raw register write: reg, value
+        NoteOn,         // channel, value = note index
+        NoteOff,        // channel
+        SetInstrument,  // channel, ins
+        SilenceAll,     // value = hardStop
+        Rhythm          // 0xBD of chip 0: clears the bits in channel, then sets value
+    };
+
+    Type type = Type::Write;
+    uint8_t channel = 0;
+    uint8_t value = 0;
+    uint16_t reg = 0;
+    uint32_t epoch = 0;   // commands from before a reset are dropped
+    uint64_t frame = 0;   // output frame to apply the command at
+    uint8_t ins[24];
+};
+
+//------------------------------------------------------------------------------
+template <typename T, uint32_t Capacity>
+class OplSpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    T mItems[Capacity];
+    alignas(64) std::atomic<uint32_t> mHead = 0; // written by consumer
+    alignas(64) std::atomic<uint32_t> mTail = 0; // written by producer
+
+public:
+    // producer only
+    bool push(const T& item)
+    {
+        uint32_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) >= Capacity)
+            return false; // full
+        mItems[tail & (Capacity - 1)] = item;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, nullptr when empty
+    const T* peek() const
+    {
+        uint32_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire))
+            return nullptr;
+        return &mItems[head & (Capacity - 1)];
+    }
+
+    // consumer only
+    void pop()
+    {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // approximate, safe from both sides
+    uint32_t size() const
+    {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+};
+
+const uint32_t OPL_COMMAND_QUEUE_SIZE = 1024;
+using OplCommandQueue = OplSpscQueue<OplCommand, OPL_COMMAND_QUEUE_SIZE>;
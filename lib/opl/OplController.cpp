@@ -3,6 +3,58 @@
 // Copyright (c) 2026 Ohmtal Game Studio
 // SPDX-License-Identifier: MIT
 //-----------------------------------------------------------------------------
+// 2026-10-17
+// * SongDataFMS keeps its notes in OplPatternStore (patterns + order list,
+//   grows on demand), .fms load / save convert from / to the legacy grid
+// * the sequencer plays an immutable snapshot (SongSnapshot), edits reach
+//   it through publishSong, export renders a snapshot without a copy
+// * .fms load / save in one read / write: decodeSongFMS validates the
+//   header and song_length against the file size (errors with the byte
+//   offset), the note grid is one bulk copy, swapped on big endian hosts
+// * audio_callback renders into a preallocated scratch block, no more
+//   vector per pull
+// * GUI calls (notes, instruments, silence) go through a lock free
+//   command queue, the audio thread no longer waits for the GUI
+// * blend, gain and saturation run in a SIMD kernel (OplPostProcess)
+//   selected at runtime
+// * RenderMode::SINC: band limited polyphase resampler (OplSincResampler)
+// * output rate and format (S16 / F32) negotiated with the device and used
+//   by the sequencer timing, the resampler and the wav export
+// * exportToWav streams chunks through OplWavWriter instead of buffering
+//   the whole song
+// * renderToWav counts the frames in 64 bit and refuses songs longer than
+//   a wav can hold (4 GB) before writing anything
+// * export renders on a private copy (cloneOffline), the live stream is no
+//   longer paused
+// * logging through OplLog.h, builds without OhmFlux (OPL_STANDALONE) for
+//   the headless fmsrender tool
+// * no SDL in the engine: the device lives in an OplAudioOutput backend
+//   (OplSdlOutput) which pulls through pullOutput, wav export uses stdio
+// * pullOutput records its timing in OplRenderStats (load, lock wait,
+//   overruns, queue depth)
+// * write drops values the chip already holds (mShadowKnown), counters for
+//   issued and elided register writes
+// * multi chip: setChipCount adds chips behind chip 0, logical channels
+//   (voices) chip * 9 + channel, OplVoiceAllocator hands out the free ones.
+//   The extra chips render on worker threads and are mixed into chip 0 in
+//   one SIMD pass (OplPostProcess::MixFn), songs stay on chip 0
+// * OPL3 mode (setOpl3Mode): both register banks, 18 channels per chip,
+//   4-op pairs (setFourOpMask), .fm3 songs and .fm4 instruments
+// * playLiveNote: polyphonic live play over the voices sharing the
+//   instrument of a channel, stealing the quietest / oldest (OplLiveVoices)
+// * note on reads A0 / B0 from a table generated at compile time
+//   (OplNoteTable), setTuning for A=432 Hz, stretched or detuned tables
+// * the wav export renders in its own format (setExportSpec, default
+//   44100 Hz S16), no longer in the one the device negotiated
+// * the render block is allocated in applyOutputSpec, pullOutput has no
+//   allocation path; allocations on the audio thread are counted by a
+//   replaced operator new (OplAudioAllocations.h)
+// * getNoteNameFromId / getIdFromNoteName use the static name table and a
+//   switch parser of OplNoteTable, no std::string per call
+// * the audio thread never waits for a chip worker that has not started,
+//   it generates that chip itself (getChipsTakenOver)
+// * drum triggers and rhythm mode update 0xBD through writeRhythm, read
+//   modify write on the render thread
 // 2026-01-11
 // * added readshadow and fixed playnote with rhythm mode
 // 2026-01-09
@@ -19,111 +71,166 @@
 //-----------------------------------------------------------------------------
 #include "OplController.h"
 #include "OPL2Instruments.h"
+#include "OplWavWriter.h"
 #include <mutex>
-
-#ifdef FLUX_ENGINE
-#include <audio/fluxAudio.h>
-#endif
+#include <cstdlib>
+#include <chrono>
+#include <format>
+#include <bit>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846f
 #endif
 
+//------------------------------------------------------------------------------
+// The thread which currently may touch the chip directly: the render thread
+// inside fillBuffer or a thread holding mDataMutex (reset, load, export).
+static thread_local const OplController* sChipOwner = nullptr;
+
+struct ChipOwnerScope {
+    const OplController* mPrev;
+    ChipOwnerScope(const OplController* owner) : mPrev(sChipOwner) { sChipOwner = owner; }
+    ~ChipOwnerScope() { sChipOwner = mPrev; }
+};
+
+// TL 63 on both operators
+static const uint8_t sSilentInstrument[24] = { 0, 0, 63, 63 };
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 //------------------------------------------------------------------------------
 OplController::OplController(){
    // mChip = new ymfm::ym3812(mInterface); //OPL2
    // mChip = new ymfm::ymf262(mInterface);//OPL3
    mChip = new ymfm::ymf289b(mInterface);//OPL3L
+   mChipBuffer = new OplChip::output_data[OPL_CHIP_CHUNK_SAMPLES + 2]();
+
+   mPostProcessKernel = OplPostProcess::detectKernel();
+   mBlendGain = OplPostProcess::getKernel(mPostProcessKernel);
+   mGain = OplPostProcess::getGainKernel(mPostProcessKernel);
+   mMixChips = OplPostProcess::getMixKernel(mPostProcessKernel);
+   // on a single core the workers only add the hand over
+   mParallelChips = std::thread::hardware_concurrency() > 1;
+
+   applyOutputSpec(mOutputSpec);
 
     reset();
 }
 
 OplController::~OplController() {
 
-    if (mStream) {
-        SDL_FlushAudioStream(mStream);
-        SDL_SetAudioStreamGetCallback(mStream, NULL, NULL);
-        SDL_DestroyAudioStream(mStream);
-        mStream = nullptr;
-    }
+    // stop the audio thread before the chip goes away
+    mAudioOutput.reset();
+
+    stopWorkers();
+    mExtraChips.clear();
 
     if (mChip) {
         delete mChip;
         mChip = nullptr;
     }
 
+    delete[] mChipBuffer;
+    mChipBuffer = nullptr;
+
 }
 //------------------------------------------------------------------------------
-void OplController::audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+void OplController::pullOutput(uint32_t frames, OutputSink sink, void* userdata)
 {
-
-    if (!userdata)
+    const OplOutputSpec::Format format = mOutputSpec.format;
+    const uint32_t frameBytes = OplOutputSpec::frameBytes(format);
+    const uint32_t requested = frames;
+    const uint32_t queueDepth = mCommands.size();
+    OplAudioAllocations::Scope audioThread;
+
+    // never wait for the GUI: while a song is loaded or reset we output silence
+    const int64_t lockStart = nowNs();
+    std::unique_lock<std::recursive_mutex> lock(mDataMutex, std::try_to_lock);
+    const int64_t renderStart = nowNs();
+    if (!lock.owns_lock()) {
+        // zero bytes are silence for S16 and F32
+        static const float silence[512 * OplRenderBlock::CHANNELS] = {};
+        while (frames > 0) {
+            uint32_t chunk = std::min<uint32_t>(frames, 512);
+            sink(userdata, silence, chunk * frameBytes);
+            frames -= chunk;
+        }
+        mRenderStats.record(requested, mOutputSpec.rate, renderStart - lockStart,
+                            nowNs() - renderStart, true, queueDepth);
         return;
+    }
 
-    auto* controller = static_cast<OplController*>(userdata);
-    if (controller && additional_amount > 0) {
-
-        std::lock_guard<std::recursive_mutex> lock(controller->mDataMutex);
-
-        int frames = additional_amount / 4; // S16 * 2 channels = 4 bytes
-
-        // Generate data directly into a temporary vector or stack buffer
-        std::vector<int16_t> temp(additional_amount / sizeof(int16_t));
-        controller->fillBuffer(temp.data(), frames);
-
-        SDL_PutAudioStreamData(stream, temp.data(), additional_amount);
+    // requests bigger than the block are rendered in several passes
+    uint8_t* block = mRenderBlock.data();
+    while (frames > 0) {
+        uint32_t toRender = std::min(frames, mRenderBlock.capacity());
+        fillBlock(block, format, toRender);
+        sink(userdata, block, toRender * frameBytes);
+        frames -= toRender;
     }
+    mRenderStats.record(requested, mOutputSpec.rate, renderStart - lockStart,
+                        nowNs() - renderStart, false, queueDepth);
+}
+//------------------------------------------------------------------------------
+void OplController::setAudioOutput(std::unique_ptr<OplAudioOutput> output)
+{
+    if (mAudioOutput)
+        mAudioOutput->close();
+    mAudioOutput = std::move(output);
 }
 //------------------------------------------------------------------------------
 bool OplController::initController()
 {
-    SDL_AudioSpec spec;
-    spec.format = SDL_AUDIO_S16;
-    spec.channels = 2;
-    spec.freq = 44100;
-
-    mStream = SDL_CreateAudioStream(&spec, &spec);
-    if (!mStream) {
-        Log("SDL_OpenAudioDeviceStream failed: %s", SDL_GetError());
+    // render in the device format so the backend has nothing to convert
+    OplOutputSpec spec;
+    OplOutputSpec device;
+    if (mAudioOutput && mAudioOutput->getDeviceSpec(device) && device.isValid())
+        spec = device;
+    return initController(spec);
+}
+//------------------------------------------------------------------------------
+bool OplController::initController(const OplOutputSpec& outputSpec)
+{
+    if (!outputSpec.isValid()) {
+        Log("ERROR: Invalid output rate %d", outputSpec.rate);
         return false;
     }
-    SDL_SetAudioStreamGetCallback(mStream, OplController::audio_callback, this);
-
-
-    #ifdef FLUX_ENGINE
-        AudioManager.bindStream(mStream);
-    #else
-        SDL_AudioDeviceID dev = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, NULL);
-
-        if (dev == 0) {
-            Log("Failed to open audio device: %s", SDL_GetError());
-            return false;
-        }
-
-        if (!SDL_BindAudioStream(dev, mStream)) {
-            Log("Failed to bind stream: %s", SDL_GetError());
-            return false;
-        }
-    #endif
-
-
-    SDL_ResumeAudioStreamDevice(mStream);
+    if (!mAudioOutput) {
+        Log("ERROR: initController without an audio output, see setAudioOutput");
+        return false;
+    }
+    mAudioOutput->close();
+    applyOutputSpec(outputSpec);
+
+    // the device buffer fits in one pass, the audio thread must not
+    // allocate (applyOutputSpec already sized it for OPL_RENDER_BLOCK_FRAMES)
+    uint32_t blockFrames = mAudioOutput->getBufferFrames();
+    if (blockFrames > mRenderBlock.capacity())
+        mRenderBlock.allocate(blockFrames, outputSpec.bytesPerFrame());
+
+    Log("INFO: OPL output %d Hz %s", outputSpec.rate,
+        (outputSpec.format == OplOutputSpec::Format::F32) ? "F32" : "S16");
+    Log("INFO: OPL post process kernel: %s (blend max deviation %d LSB, gain %d LSB)",
+        OplPostProcess::getKernelName(mPostProcessKernel),
+        OplPostProcess::compareToScalar(mPostProcessKernel),
+        OplPostProcess::compareGainToScalar(mPostProcessKernel));
 
     // null the cache
     std::memset(m_instrument_cache, 0, sizeof(m_instrument_cache));
     std::memset(m_instrument_name_cache, 0, sizeof(m_instrument_name_cache));
 
-
-    return true;
+    return mAudioOutput->open(*this, outputSpec);
 }
 
 //------------------------------------------------------------------------------
 bool OplController::shutDownController()
 {
-    if (mStream) {
-        SDL_DestroyAudioStream(mStream);
-        mStream = nullptr;
-    }
+    if (mAudioOutput)
+        mAudioOutput->close();
     return true;
 }
 
@@ -136,7 +243,48 @@ void OplController::set_speed(uint8_t songspeed)
     float base_hz = PLAYBACK_FREQUENCY;
     float ticks_per_second = base_hz / (float)songspeed;
 
-    mSeqState.samples_per_tick = (int)(44100.0f / ticks_per_second);
+    mSeqState.samples_per_tick = (int)((float)mOutputSpec.rate / ticks_per_second);
+}
+//------------------------------------------------------------------------------
+bool OplController::setOutputSpec(const OplOutputSpec& spec)
+{
+    if (!spec.isValid())
+        return false;
+    if (isLive() && !(spec == mOutputSpec)) {
+        Log("ERROR: setOutputSpec: the audio output is running, use initController");
+        return false;
+    }
+    applyOutputSpec(spec);
+    return true;
+}
+//------------------------------------------------------------------------------
+bool OplController::setExportSpec(const OplOutputSpec& spec)
+{
+    if (!spec.isValid())
+        return false;
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    mExportSpec = spec;
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplController::applyOutputSpec(const OplOutputSpec& spec)
+{
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    mOutputSpec = spec;
+
+    // the chip advances 44100 / (49716 / 44100) samples per second of
+    // output at every rate, so pitch and tempo do not depend on the rate
+    m_step = (49716.0 / 44100.0) * ((double)spec.rate / 44100.0);
+    m_pos = 0.0;
+
+    // pullOutput renders into the block in this format and never allocates
+    if (mRenderBlock.capacity() < OPL_RENDER_BLOCK_FRAMES || mRenderBlock.frameBytes() != spec.bytesPerFrame())
+        mRenderBlock.allocate(std::max(mRenderBlock.capacity(), OPL_RENDER_BLOCK_FRAMES), spec.bytesPerFrame());
+    mSinc.configure((double)spec.rate / m_step, (double)spec.rate, OPL_CHIP_CHUNK_SAMPLES);
+    mSincActive = false;
+
+    if (mSeqState.current_song)
+        set_speed(mSeqState.current_song->song_delay);
 }
 //------------------------------------------------------------------------------
 void OplController::setPlaying(bool value, bool hardStop)
@@ -173,9 +321,14 @@ uint8_t OplController::get_modulator_offset(uint8_t channel){
 void OplController::silenceAll(bool hardStop) {
     // Stop all notes physically via Key-Off
 
-    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::SilenceAll;
+    cmd.value = hardStop ? 1 : 0;
+    if (deferCommand(cmd))
+        return;
 
-    for (int i = FMS_MIN_CHANNEL; i <= FMS_MAX_CHANNEL; ++i) {
+    // every voice, the extra chips included
+    for (int i = FMS_MIN_CHANNEL; i < (int)getVoiceCount(); ++i) {
         stopNote(i);
 
         if (hardStop )
@@ -183,34 +336,46 @@ void OplController::silenceAll(bool hardStop) {
             // Write TL=63 to both Modulator and Carrier for every channel
             // Modulator TL addresses: 0x40 - 0x55
             // Carrier TL addresses:   0x40 - 0x55 (offset by +3)
-            uint8_t mod_offset = get_modulator_offset(i);
-            uint8_t car_offset = get_carrier_offset(i);
+            const OplVoiceAllocator::Voice voice = mVoices.locate(i);
+            uint16_t mod_offset = modulatorReg(voice.channel);
+            uint16_t car_offset = mod_offset + 3;
 
-            write(0x40 + mod_offset, 63); // Silence Modulator
-            write(0x40 + car_offset, 63); // Silence Carrier
+            writeChip(voice.chip, 0x40 + mod_offset, 63); // Silence Modulator
+            writeChip(voice.chip, 0x40 + car_offset, 63); // Silence Carrier
         }
     }
 }
 //------------------------------------------------------------------------------
 void OplController::reset() {
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    ChipOwnerScope owner(this);
+
+    // drop commands queued before the reset
+    mCommandEpoch.fetch_add(1, std::memory_order_acq_rel);
+
     mChip->reset();
+    mShadowKnown.reset();
+    for (auto& extra : mExtraChips) {
+        extra->chip->reset();
+        extra->known.reset();
+    }
     m_pos = 0.0;
 
-    // A truly "silent" instrument has Total Level = 63
-    uint8_t silent_ins[24];
-    memset(silent_ins, 0, 24);
-    silent_ins[2] = 63; // Modulator TL (Silent)
-    silent_ins[3] = 63; // Carrier TL (Silent)
+    // the reset cleared NEW, bank 1 needs it before the instruments
+    if (mOpl3Mode)
+        for (uint8_t chip = 0; chip < getChipCount(); chip++)
+            applyOpl3Registers(chip);
 
-    for (int i = 0; i < 9; ++i) {
-        setInstrument(i, silent_ins);
+    // A truly "silent" instrument has Total Level = 63
+    for (uint32_t i = 0; i < getVoiceCount(); ++i) {
+        setInstrument(i, sSilentInstrument);
     }
 
     mSeqState.song_needle = 0;
     this->silenceAll(true);
 }
 //------------------------------------------------------------------------------
-void OplController::write(uint16_t reg, uint8_t val)
+void OplController::writeChip(uint8_t chip, uint16_t reg, uint8_t val)
 {
     #ifdef FM_DEBUG
     if (reg >= 0xB0 && reg <= 0xB8) {
@@ -218,9 +383,121 @@ void OplController::write(uint16_t reg, uint8_t val)
                 reg, val, (val & 0x20) ? "YES" : "NO");
     }
     #endif
-    mShadowRegs[reg] = val; // 2026-01-11
-    mChip->write_address(reg);
-    mChip->write_data(val);
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::Write;
+    cmd.channel = chip;
+    cmd.reg = reg;
+    cmd.value = val;
+    if (deferCommand(cmd))
+        return;
+
+    if (chip > mExtraChips.size())
+        return;
+    OplChip* target = mChip;
+    uint8_t* shadow = mShadowRegs;
+    std::bitset<512>* known = &mShadowKnown;
+    if (chip > 0) {
+        ExtraChip& extra = *mExtraChips[chip - 1];
+        target = extra.chip.get();
+        shadow = extra.shadow;
+        known = &extra.known;
+    }
+
+    // the chip already holds this value: setInstrument rewrites the whole
+    // operator pair, usually only one of them changed. Register writes are
+    // level triggered (key on included), only the timer / IRQ registers
+    // act on every write.
+    const uint8_t lowReg = reg & 0xFF;
+    if (mRegisterCoalescing && (*known)[reg] && shadow[reg] == val
+        && (lowReg < 0x02 || lowReg > 0x04)) {
+        mRegWritesElided.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    shadow[reg] = val; // 2026-01-11
+    (*known)[reg] = true;
+    // bank 1 (OPL3) through the second address port
+    if (reg & 0x100)
+        target->write_address_hi(lowReg);
+    else
+        target->write_address(lowReg);
+    target->write_data(val);
+    mRegWritesIssued.fetch_add(1, std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+// The shadow is read when the command is applied: the GUI shadow lags the
+// queued writes, two triggers in one block would lose each other's bits.
+void OplController::writeRhythm(uint8_t clearMask, uint8_t setMask)
+{
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::Rhythm;
+    cmd.channel = clearMask;
+    cmd.value = setMask;
+    if (deferCommand(cmd))
+        return;
+
+    write(0xBD, (readShadow(0xBD) & ~clearMask) | setMask);
+}
+//------------------------------------------------------------------------------
+bool OplController::isChipOwner() const
+{
+    return sChipOwner == this;
+}
+//------------------------------------------------------------------------------
+// Without a live output nobody renders concurrently, so we apply directly.
+bool OplController::deferCommand(OplCommand cmd)
+{
+    if (!isLive() || isChipOwner())
+        return false;
+
+    cmd.epoch = mCommandEpoch.load(std::memory_order_acquire);
+    cmd.frame = commandTimestamp();
+    if (!mCommands.push(cmd)) {
+        // never block the GUI, count it instead
+        mCommandsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+// The GUI time is mapped into the next block with a constant latency of one
+// block: a command issued k frames after the last block started is played k
+// frames after the start of the next block.
+uint64_t OplController::commandTimestamp() const
+{
+    uint64_t blockStart = mBlockStartFrame.load(std::memory_order_acquire);
+    uint64_t blockFrames = mBlockFrames.load(std::memory_order_acquire);
+    int64_t elapsedNs = nowNs() - mBlockStartNs.load(std::memory_order_acquire);
+
+    uint64_t offset = 0;
+    if (elapsedNs > 0)
+        offset = std::min<uint64_t>((uint64_t)(elapsedNs * mOutputSpec.rate / 1000000000LL), blockFrames);
+
+    return blockStart + blockFrames + offset;
+}
+//------------------------------------------------------------------------------
+void OplController::drainCommands(uint64_t frame)
+{
+    uint32_t epoch = mCommandEpoch.load(std::memory_order_acquire);
+    while (const OplCommand* cmd = mCommands.peek()) {
+        if (cmd->frame > frame && cmd->epoch == epoch)
+            break;
+        if (cmd->epoch == epoch)
+            applyCommand(*cmd);
+        mCommands.pop();
+    }
+}
+//------------------------------------------------------------------------------
+void OplController::applyCommand(const OplCommand& cmd)
+{
+    switch (cmd.type)
+    {
+        case OplCommand::Type::Write:         writeChip(cmd.channel, cmd.reg, cmd.value); break;
+        case OplCommand::Type::NoteOn:        playNoteDOS(cmd.channel, cmd.value); break;
+        case OplCommand::Type::NoteOff:       stopNote(cmd.channel); break;
+        case OplCommand::Type::SetInstrument: applyInstrument(cmd.channel, cmd.ins); break;
+        case OplCommand::Type::SilenceAll:    silenceAll(cmd.value != 0); break;
+        case OplCommand::Type::Rhythm:        writeRhythm(cmd.channel, cmd.value); break;
+    }
 }
 //------------------------------------------------------------------------------
 // 0x10: Bass Drum (uses Operators 13 & 16)
@@ -275,37 +552,47 @@ void OplController::playDrum(int channel, int noteIndex) {
 
     if (drumMask > 0) {
         // 1. Set frequency for the correct channel
-        write(0xA0 + channel, myDosScale[noteIndex][1]);
-        write(0xB0 + channel, myDosScale[noteIndex][0] & ~0x20);
+        const OplNoteRegs regs = mDosNotes[noteIndex];
+        write(0xA0 + channel, regs.a0);
+        write(0xB0 + channel, regs.b0 & ~0x20);
 
         // 2. Trigger the bit in 0xBD
-        uint8_t currentBD = readShadow(0xBD);
-        write(0xBD, currentBD & ~drumMask); // Clear
-        write(0xBD, currentBD | drumMask);  // Trigger
+        writeRhythm(drumMask, 0); // Clear
+        writeRhythm(0, drumMask); // Trigger
     }
 }
 
 //------------------------------------------------------------------------------
 void OplController::playNoteDOS(int channel, int noteIndex) {
-    if (channel < 0 || channel > 8) return;
-    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    if (channel < 0 || channel >= (int)getVoiceCount()) return;
+
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::NoteOn;
+    cmd.channel = (uint8_t)channel;
+    cmd.value = (noteIndex < 0 || noteIndex > 255) ? 0 : (uint8_t)noteIndex;
+    if (deferCommand(cmd))
+        return;
+
+    // the notes of a 4-op pair play on its first channel
+    if (isFourOpSecondary(channel))
+        return;
 
     if (noteIndex <= 0 || noteIndex >= 85) {
         stopNote(channel);
         return;
     }
-    // --- RHYTHM MODE LOGIC ---
-    if (!mMelodicMode && channel >= 6) {
+    // --- RHYTHM MODE LOGIC (chip 0 only) ---
+    if (!mMelodicMode && channel >= 6 && channel <= FMS_MAX_CHANNEL) {
         playDrum(channel, noteIndex);
         return;
     }
 
     // --- STANDARD MELODIC LOGIC (Channels 0-5, or all if MelodicMode is true) ---
     stopNote(channel);
-    uint8_t b0_val = myDosScale[noteIndex][0];
-    uint8_t a0_val = myDosScale[noteIndex][1];
-    write(0xA0 + channel, a0_val);
-    write(0xB0 + channel, b0_val);
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
+    const OplNoteRegs regs = mDosNotes[noteIndex];
+    writeChip(voice.chip, 0xA0 + channelReg(voice.channel), regs.a0);
+    writeChip(voice.chip, 0xB0 + channelReg(voice.channel), regs.b0);
 
     // OplRegs calibrated = convertSampleRate(myDosScale[noteIndex][1], myDosScale[noteIndex][0]);
     // write(0xA0 + channel, calibrated.a0);
@@ -323,50 +610,82 @@ void OplController::playNoteDOS(int channel, int noteIndex) {
 }
 
 //------------------------------------------------------------------------------
-void OplController::playNote(int channel, int noteIndex) {
-    if (channel < 0 || channel > 8)
-        return;
+void OplController::setTuning(const OplTuning& tuning) {
+    // the standard tuning is the DOS table, byte for byte
+    static_assert([] {
+        for (int id = 1; id < OplNoteTable::DOS_NOTES; id++)
+            if (OplNoteTable::DOS_STANDARD[id].b0 != myDosScale[id][0] || OplNoteTable::DOS_STANDARD[id].a0 != myDosScale[id][1])
+                return false;
+        for (int note = 0; note < 12; note++)
+            if ((OplNoteTable::CHROMATIC_STANDARD[note].a0 | (OplNoteTable::CHROMATIC_STANDARD[note].b0 & 3) << 8) != f_numbers[note])
+                return false;
+        return true;
+    }(), "OplNoteTable::STANDARD no longer reproduces myDosScale");
 
+    // the render thread plays the sequencer from the tables
     std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    mTuning = tuning;
+    mDosNotes = OplNoteTable::makeDos(tuning);
+    mChromaticNotes = OplNoteTable::makeChromatic(tuning);
+}
+//------------------------------------------------------------------------------
+void OplController::playNote(int channel, int noteIndex) {
+    if (channel < 0 || channel >= (int)getVoiceCount()
+        || noteIndex < 0 || noteIndex >= OplNoteTable::CHROMATIC_NOTES)
+        return;
 
+    // stopNote and write queue themselves when called from the GUI
     stopNote(channel);
 
-
-    int octave = noteIndex / 12;
-    int note = noteIndex % 12;
-    uint16_t fnum = f_numbers[note];
+    // octave * 12 + note, the octave is the block
+    const OplNoteRegs regs = mChromaticNotes[noteIndex];
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
 
     // Register 0xA0: Low 8 bits of F-Number
-    write(0xA0 + channel, fnum & 0xFF);
+    writeChip(voice.chip, 0xA0 + channelReg(voice.channel), regs.a0);
 
     // Register 0xB0: Key-On (0x20) | Octave | F-Number High bits
-    uint8_t b0_val = 0x20 | (octave << 2) | (fnum >> 8);
-
-
-    write(0xB0 + channel, b0_val);
+    writeChip(voice.chip, 0xB0 + channelReg(voice.channel), regs.b0);
 }
 //------------------------------------------------------------------------------
 void OplController::stopNote(int channel) {
-    if (channel < 0 || channel > 8) return;
+    if (channel < 0 || channel >= (int)getVoiceCount()) return;
 
-    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::NoteOff;
+    cmd.channel = (uint8_t)channel;
+    if (deferCommand(cmd))
+        return;
+
+    // a 4-op pair keys off through its first channel
+    if (isFourOpSecondary(channel))
+        return;
+
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
 
     // --- RHYTHM MODE STOP ---
-    if (!mMelodicMode && channel >= 6) {
+    if (!mMelodicMode && channel >= 6 && channel <= FMS_MAX_CHANNEL) {
         // In Rhythm Mode, we clear the trigger bits in 0xBD
         uint8_t drumMask = 0;
         if (channel == 6) drumMask = 0x10; // Bass Drum
         if (channel == 7) drumMask = 0x08 | 0x01; // Snare & Hi-Hat
         if (channel == 8) drumMask = 0x04 | 0x02; // Tom & Cymbal
 
-
-        uint8_t currentBD = readShadow(0xBD);
-        write(0xBD, currentBD & ~drumMask);
+        writeRhythm(drumMask, 0);
+    }
+    else if (voice.chip > 0) {
+        // --- EXTRA CHIP: melodic only ---
+        const uint16_t reg = 0xB0 + channelReg(voice.channel);
+        // no extra clock as for chip 0 below: it would put this chip one
+        // sample ahead of the others, the key off lands in the next chunk
+        writeChip(voice.chip, reg, readShadowChip(voice.chip, reg) & ~0x20);
+        return;
     }
     else {
         // --- MELODIC MODE STOP ---
-        uint8_t b0_val = readShadow(0xB0 + channel) & ~0x20;
-        write(0xB0 + channel, b0_val);
+        const uint16_t reg = 0xB0 + channelReg(voice.channel);
+        uint8_t b0_val = readShadow(reg) & ~0x20;
+        write(reg, b0_val);
 
     }
 
@@ -376,18 +695,40 @@ void OplController::stopNote(int channel) {
 
 //------------------------------------------------------------------------------
 void OplController::setInstrument(uint8_t channel, const uint8_t lIns[24]) {
-    if (channel > FMS_MAX_CHANNEL) return;
+    if (channel >= getVoiceCount()) return;
 
-    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    // the cache belongs to the caller, the registers to the render thread
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
+    mInstrumentRevision++;
+    if (voice.chip == 0)
+        memcpy(m_instrument_cache[voice.channel], lIns, 24);
+    else
+        memcpy(mExtraChips[voice.chip - 1]->instruments[voice.channel], lIns, 24);
 
-    memcpy(m_instrument_cache[channel], lIns, 24);
+    OplCommand cmd;
+    cmd.type = OplCommand::Type::SetInstrument;
+    cmd.channel = channel;
+    memcpy(cmd.ins, lIns, 24);
+    if (deferCommand(cmd))
+        return;
 
+    applyInstrument(channel, lIns);
+}
+//------------------------------------------------------------------------------
+void OplController::applyInstrument(uint8_t channel, const uint8_t lIns[24]) {
     // Pointer for our data (allows us to use the hi-hat test override)
     const uint8_t* p_ins = lIns;
 
-    // Get the hardware offsets based on your Adr_add logic
-    uint8_t mod_off = get_modulator_offset(channel); // Adr_add[channel]
-    uint8_t car_off = get_carrier_offset(channel);   // Adr_add[channel] + 3
+    // logical channel => chip and its channel
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
+    const uint8_t chip = voice.chip;
+    channel = voice.channel;
+    auto write = [this, chip](uint16_t reg, uint8_t val) { writeChip(chip, reg, val); };
+
+    // Get the hardware offsets based on your Adr_add logic, bank 1 for
+    // the channels 9..17 in OPL3 mode
+    uint16_t mod_off = modulatorReg(channel); // Adr_add[channel]
+    uint16_t car_off = mod_off + 3;           // Adr_add[channel] + 3
 
     // 1. Multiplier / Sustain Mode / Vibrato ($20 range)
     write(0x20 + mod_off, p_ins[0] | (p_ins[14] << 5) | (p_ins[16] << 6) | (p_ins[18] << 7));
@@ -410,7 +751,8 @@ void OplController::setInstrument(uint8_t channel, const uint8_t lIns[24]) {
     write(0xE0 + car_off, p_ins[13]);
 
     // 6. Connection / Feedback ($C0 range) - CHANNEL BASED, not operator based
-    write(0xC0 + channel, p_ins[21] | (p_ins[20] << 1));
+    //    OPL3 mode: without the panning bits (left | right) it is silent
+    write(0xC0 + channelReg(channel), p_ins[21] | (p_ins[20] << 1) | (mOpl3Mode ? 0x30 : 0));
 
     // Global Setup (Ensure waveforms are enabled)
     write(0x01, 0x20);
@@ -434,7 +776,8 @@ void OplController::setInstrument(uint8_t channel, const uint8_t lIns[24]) {
     // 0xC0	0	Melodic	9 FM Channels. 100% control over every sound.
     // 0xE0	1	Rhythm	6 FM Channels + 5 fixed Drum sounds.
     // -----------------------------------------------------------------
-     if (mMelodicMode)
+     // the extra chips are melodic only
+     if (mMelodicMode || chip > 0)
         write(0xBD, 0xC0);
     else
         write(0xBD, 0xE0);
@@ -444,78 +787,181 @@ void OplController::setInstrument(uint8_t channel, const uint8_t lIns[24]) {
 }
 //------------------------------------------------------------------------------
 const uint8_t* OplController::getInstrument(uint8_t channel) const{
-    if (channel > FMS_MAX_CHANNEL) return nullptr;
-    return m_instrument_cache[channel];
+    if (channel >= getVoiceCount()) return nullptr;
+    const OplVoiceAllocator::Voice voice = mVoices.locate(channel);
+    if (voice.chip > 0)
+        return mExtraChips[voice.chip - 1]->instruments[voice.channel];
+    return m_instrument_cache[voice.channel];
 }
 //------------------------------------------------------------------------------
-bool OplController::loadSongFMS(const std::string& filename, SongDataFMS& sd) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        Log("ERROR: Could not open song file: %s", filename.c_str());
+// little endian on disk, swapped on big endian hosts
+static void notesFromLE(int16_t* notes, size_t count)
+{
+    if constexpr (std::endian::native == std::endian::big) {
+        for (size_t i = 0; i < count; i++) {
+            const uint16_t v = (uint16_t)notes[i];
+            notes[i] = (int16_t)(uint16_t)((v >> 8) | (v << 8));
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// the .fms layout (channels x (name, instrument), song_delay, song_length,
+// note grid) behind base bytes of header, shared by .fms and .fm3
+static bool decodeSongBody(const uint8_t* data, size_t size, OplController::SongDataFMS& sd, const char* name,
+                           size_t base, uint32_t channels)
+{
+    const size_t perChannel = 256 + 24;
+    const size_t headerBytes = base + channels * perChannel + 1 + 2;
+    if (size < headerBytes) {
+        // name the field the file ends in
+        const size_t channel = (size - base) / perChannel;
+        if (channel < channels)
+            Log("ERROR: %s: truncated at offset %zu in the %s of channel %zu, the header needs %zu bytes",
+                name, size, (size - base) % perChannel < 256 ? "name" : "instrument", channel + 1, headerBytes);
+        else
+            Log("ERROR: %s: truncated at offset %zu in song_delay / song_length, the header needs %zu bytes",
+                name, size, headerBytes);
         return false;
     }
 
-    reset(); //reset everything !!
-
-    // 1. Interleaved Load: Name then Settings for each channel
-    for (int ch = 1; ch <= 9; ++ch) {
-        if (!file.read(reinterpret_cast<char*>(sd.actual_ins[ch]), 256)) {
-            Log("ERROR: Failed reading Name for Channel %d at offset %ld", ch, (long)file.tellg());
-            file.close();
-            return false;
-        }
-        if (!file.read(reinterpret_cast<char*>(sd.ins_set[ch]), 24)) {
-            Log("ERROR: Failed reading Settings for Channel %d at offset %ld", ch, (long)file.tellg());
-            file.close();
-            return false;
-        }
+    const size_t lengthOffset = base + channels * perChannel + 1;
+    const uint16_t songLength = (uint16_t)(data[lengthOffset] | (data[lengthOffset + 1] << 8));
+    const size_t cells = (size_t)songLength * channels;
+    const size_t needed = headerBytes + cells * sizeof(int16_t);
+    if (size < needed) {
+        const size_t cell = (size - headerBytes) / sizeof(int16_t);
+        Log("ERROR: %s: song_length %u (offset %zu) needs %zu bytes, the file ends at offset %zu in row %zu, channel %zu",
+            name, songLength, lengthOffset, needed, size,
+            cell / channels, cell % channels + 1);
+        return false;
     }
-
-    // 2. Load Speed (1 byte) and Length (2 bytes)
-    if (!file.read(reinterpret_cast<char*>(&sd.song_delay), 1)) {
-        Log("ERROR: Failed reading song_speed");
-        file.close();
+    if (size > needed)
+        Log("WARNING: %s: %zu bytes after the note grid (offset %zu) ignored", name, size - needed, needed);
+
+    // the grid starts at an odd offset, one copy into aligned notes
+    std::vector<int16_t> grid(cells);
+    std::memcpy(grid.data(), data + headerBytes, cells * sizeof(int16_t));
+    notesFromLE(grid.data(), cells);
+
+    for (uint32_t ch = 1; ch <= channels; ++ch) {
+        const uint8_t* block = data + base + (ch - 1) * perChannel;
+        std::memcpy(sd.actual_ins[ch], block, 256);
+        std::memcpy(sd.ins_set[ch], block + 256, 24);
+    }
+    sd.song_delay = data[base + channels * perChannel];
+    sd.song_length = songLength;
+    sd.notes.importRows(grid.data(), songLength, channels);
+    return true;
+}
+//------------------------------------------------------------------------------
+static void encodeSongBody(const OplController::SongDataFMS& sd, std::vector<uint8_t>& out, size_t base, uint32_t channels)
+{
+    const size_t perChannel = 256 + 24;
+    const size_t headerBytes = base + channels * perChannel + 1 + 2;
+    const size_t cells = (size_t)sd.song_length * channels;
+    out.resize(headerBytes + cells * sizeof(int16_t));
+
+    for (uint32_t ch = 1; ch <= channels; ++ch) {
+        uint8_t* block = out.data() + base + (ch - 1) * perChannel;
+        std::memcpy(block, sd.actual_ins[ch], 256);
+        std::memcpy(block + 256, sd.ins_set[ch], 24);
+    }
+    uint8_t* tail = out.data() + base + channels * perChannel;
+    tail[0] = sd.song_delay;
+    tail[1] = (uint8_t)(sd.song_length & 0xFF);
+    tail[2] = (uint8_t)(sd.song_length >> 8);
+
+    std::vector<int16_t> grid(cells);
+    sd.notes.exportRows(grid.data(), sd.song_length, channels);
+    notesFromLE(grid.data(), cells); // the swap is its own inverse
+    std::memcpy(out.data() + headerBytes, grid.data(), cells * sizeof(int16_t));
+}
+//------------------------------------------------------------------------------
+bool OplController::decodeSongFMS(const uint8_t* data, size_t size, SongDataFMS& sd, const char* name)
+{
+    if (!decodeSongBody(data, size, sd, name, 0, FMS_MAX_CHANNEL + 1))
+        return false;
+    sd.opl3 = false;
+    sd.four_op = 0;
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplController::encodeSongFMS(const SongDataFMS& sd, std::vector<uint8_t>& out)
+{
+    encodeSongBody(sd, out, 0, FMS_MAX_CHANNEL + 1);
+}
+//------------------------------------------------------------------------------
+bool OplController::decodeSongFM3(const uint8_t* data, size_t size, SongDataFMS& sd, const char* name)
+{
+    if (size < 6 || !isSongFM3(data, size)) {
+        Log("ERROR: %s: no .fm3 header (%zu bytes)", name, size);
         return false;
     }
-    if (!file.read(reinterpret_cast<char*>(&sd.song_length), 2)) {
-        Log("ERROR: Failed reading song_length");
-        file.close();
+    if (data[4] != FM3_VERSION) {
+        Log("ERROR: %s: .fm3 version %u (offset 4) is not supported, expected %u", name, data[4], FM3_VERSION);
         return false;
     }
+    if (data[5] & ~0x3F)
+        Log("WARNING: %s: unknown 4-op bits 0x%02X (offset 5) ignored", name, data[5] & ~0x3F);
 
-    Log("INFO: Song Header Loaded. Speed: %u, Length: %u", sd.song_delay, sd.song_length);
-
-    // Safety check for 2026 memory limits
-    if (sd.song_length > FMS_MAX_SONG_LENGTH) {
-        Log("ERROR: song_length (%u) exceeds maximum allowed (1000)", sd.song_length);
-        file.close();
+    if (!decodeSongBody(data, size, sd, name, 6, FMS_OPL3_CHANNELS))
+        return false;
+    sd.opl3 = true;
+    sd.four_op = data[5] & 0x3F;
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplController::encodeSongFM3(const SongDataFMS& sd, std::vector<uint8_t>& out)
+{
+    encodeSongBody(sd, out, 6, FMS_OPL3_CHANNELS);
+    std::memcpy(out.data(), FM3_MAGIC, 4);
+    out[4] = FM3_VERSION;
+    out[5] = sd.four_op & 0x3F;
+}
+//------------------------------------------------------------------------------
+bool OplController::loadSongFMS(const std::string& filename, SongDataFMS& sd) {
+    // one read of the whole file, a full song is about 20 KB
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        Log("ERROR: Could not open song file: %s", filename.c_str());
         return false;
     }
-
-    // 3. Load Note Grid (Adjusted for 0-based C++ logic)
-    for (int i = 0; i < sd.song_length; ++i) { // Start at 0
-        for (int j = 0; j <= FMS_MAX_CHANNEL; ++j) {           // Start at 0
-            int16_t temp_note;
-            if (!file.read(reinterpret_cast<char*>(&temp_note), 2)) {
-                Log("ERROR: Failed reading Note at Tick %d, Channel %d", i, j);
-                file.close();
-                return false;
-            }
-            // Store it 0-based so sd.song[0][0] is the first note
-            sd.song[i][j] = temp_note;
-        }
+    const std::streamsize size = file.tellg();
+    std::vector<uint8_t> data(size > 0 ? (size_t)size : 0);
+    file.seekg(0);
+    if (size < 0 || !file.read(reinterpret_cast<char*>(data.data()), size)) {
+        Log("ERROR: Failed reading song file: %s", filename.c_str());
+        return false;
     }
+    file.close();
+
+    // decode into a scratch song, a broken file leaves sd as it was
+    SongDataFMS loaded;
+    if (isSongFM3(data.data(), data.size())) {
+        if (!decodeSongFM3(data.data(), data.size(), loaded, filename.c_str()))
+            return false;
+    } else if (!decodeSongFMS(data.data(), data.size(), loaded, filename.c_str()))
+        return false;
+
+    Log("INFO: Song Header Loaded. Speed: %u, Length: %u", loaded.song_delay, loaded.song_length);
+    // the DOS composer stops at 1000 rows, the pattern store does not
+    if (loaded.song_length > FMS_MAX_SONG_LENGTH)
+        Log("INFO: song_length (%u) is longer than the DOS composer allows (%d)", loaded.song_length, FMS_MAX_SONG_LENGTH);
+
+    reset(); //reset everything !!
+    sd = std::move(loaded);
+    setOpl3Mode(sd.opl3);
+    setFourOpMask(sd.four_op);
 
     Log("SUCCESS: Song '%s' loaded completely.", filename.c_str());
 
-    // 4. Update OPL with new instruments
-    for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch) {
+    // Update OPL with new instruments
+    for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch) {
         // Hardware Channel 'i' (0-8) gets Instrument Data 'i+1' (1-9)
         setInstrument(ch, sd.ins_set[ch + 1]);
         setInstrumentNameInCache(ch, GetInstrumentName(sd,ch).c_str());
     }
 
-    file.close();
     return true;
 }
 //------------------------------------------------------------------------------
@@ -523,7 +969,7 @@ bool OplController::loadSongFMS(const std::string& filename, SongDataFMS& sd) {
  *  Returns a null-terminated C-string for display/UI
  */
 std::string OplController::GetInstrumentName(SongDataFMS& sd, int channel) {
-    if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+    if (channel < FMS_MIN_CHANNEL || channel >= sd.getChannelCount())
     {
         Log("Error: GetInstrumentName with invalid channel ! %d", channel);
         return "";
@@ -535,7 +981,7 @@ std::string OplController::GetInstrumentName(SongDataFMS& sd, int channel) {
  *  Converts a C-string back into the Pascal [Length][Data...] format
  */
 bool OplController::SetInstrumentName(SongDataFMS& sd, int channel, const char* name) {
-    if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+    if (channel < FMS_MIN_CHANNEL || channel >= sd.getChannelCount())
     {
         Log("Error: setInstrumentName with invalid channel ! %d", channel);
         return false;
@@ -546,52 +992,70 @@ bool OplController::SetInstrumentName(SongDataFMS& sd, int channel, const char*
 
 //------------------------------------------------------------------------------
 bool OplController::saveSongFMS(const std::string& filename, SongDataFMS& sd) {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) return false;
+    // the song is saved in the mode the chip plays (.fm3 in OPL3 mode)
+    sd.opl3 = mOpl3Mode;
+    sd.four_op = mOpl3Mode ? mFourOpMask : 0;
 
-    // Sync Live Cache to SongData (Slots 1-9)
+    // Sync Live Cache to SongData (Slots 1-9, 1-18 in OPL3 mode)
     // Clear Slot 0 so it remains "empty"
     std::memset(sd.ins_set[0], 0, 24);
-    // Copy 9 live instruments from cache into sd.ins_set[1...9]
-    std::memcpy(&sd.ins_set[1][0], m_instrument_cache, sizeof(m_instrument_cache));
-
-    // Write Instruments (Indices 1-9)
-    for (int ch = 1; ch <= 9; ++ch) {
-        // FIX: Must write 256 bytes for name to match your loader's file.read(..., 256)
-        file.write(reinterpret_cast<const char*>(sd.actual_ins[ch]), 256);
-
-        // Write 24 bytes for instrument settings
-        file.write(reinterpret_cast<const char*>(sd.ins_set[ch]), 24);
+    // Copy the live instruments from cache into sd.ins_set[1...]
+    std::memcpy(&sd.ins_set[1][0], m_instrument_cache, (size_t)sd.getChannelCount() * 24);
+
+    if (sd.song_length > FMS_MAX_SONG_LENGTH)
+        Log("WARNING: song_length (%u) is longer than the DOS composer allows (%d)", sd.song_length, FMS_MAX_SONG_LENGTH);
+
+    // a .fms holds 9 channels, notes on the channels of bank 1 are lost
+    if (!sd.opl3) {
+        for (uint32_t row = 0; row < sd.song_length; row++) {
+            int16_t line[OplPatternStore::CHANNELS];
+            sd.notes.getRow(row, line);
+            if (std::any_of(line + FMS_MAX_CHANNEL + 1, line + FMS_OPL3_CHANNELS, [](int16_t n) { return n != 0; })) {
+                Log("WARNING: %s: notes on the channels 10..18 (row %u) are not saved in a .fms", filename.c_str(), row);
+                break;
+            }
+        }
     }
 
-    // Write Metadata
-    // Loader expects 1 byte for delay
-    uint8_t delay8 = static_cast<uint8_t>(sd.song_delay);
-    file.write(reinterpret_cast<const char*>(&delay8), 1);
-
-    // Loader expects 2 bytes for length
-    file.write(reinterpret_cast<const char*>(&sd.song_length), 2);
+    // the whole image in one write
+    std::vector<uint8_t> data;
+    if (sd.opl3)
+        encodeSongFM3(sd, data);
+    else
+        encodeSongFMS(sd, data);
 
-    // Write Notes
-    for (int i = 0; i < sd.song_length; ++i) {
-        for (int j = 0; j <= FMS_MAX_CHANNEL; ++j) {
-            file.write(reinterpret_cast<const char*>(&sd.song[i][j]), 2);
-        }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        Log("ERROR: Could not write song file: %s", filename.c_str());
+        return false;
     }
-
+    file.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
     file.close();
     return file.good();
 }
 //------------------------------------------------------------------------------
-void OplController::start_song(SongDataFMS& sd, bool loopit, int startAt, int stopAt)
+void OplController::start_song(SongSnapshot song, bool loopit, int startAt, int stopAt)
 {
-    // SDL2 SDL_LockAudio(); // Stop the callback thread for a microsecond
+    if (!song)
+        return;
 
-    mSeqState.current_song = &sd;
+    // an older version published meanwhile must not replace this one
+    mSongExchange.clear();
+
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    const SongDataFMS& sd = *song;
+    // an .fm3 needs both banks, a .fms plays on the OPL2 part
+    if (sd.opl3 != mOpl3Mode)
+        setOpl3Mode(sd.opl3);
+    if (sd.opl3 && sd.four_op != mFourOpMask)
+        setFourOpMask(sd.four_op);
+    mPlayingSong = std::move(song);
+    mSeqState.current_song = mPlayingSong.get();
 
     // when playing a part of the song
     mSeqState.song_startAt  = startAt;
 
+    mSeqState.play_to_end = stopAt <= startAt;
     if ( stopAt > startAt )
         mSeqState.song_stopAt  = stopAt;
     else
@@ -605,14 +1069,39 @@ void OplController::start_song(SongDataFMS& sd, bool loopit, int startAt, int st
     mSeqState.loop = loopit;
     set_speed(sd.song_delay);
     mSeqState.playing = true;
-    // SDL2 SDL_UnlockAudio(); // Let the callback thread resume
+}
+//------------------------------------------------------------------------------
+void OplController::publishSong(SongSnapshot song)
+{
+    if (!song)
+        return;
+    mSongExchange.publish(std::move(song));
+    // nobody renders concurrently, take it now
+    if (!isLive()) {
+        std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+        adoptPublishedSong();
+    }
+}
+//------------------------------------------------------------------------------
+void OplController::adoptPublishedSong()
+{
+    if (!mSongExchange.adopt(mPlayingSong))
+        return;
+
+    const SongDataFMS& sd = *mPlayingSong;
+    mSeqState.current_song = &sd;
+    if (mSeqState.play_to_end || mSeqState.song_stopAt > sd.song_length)
+        mSeqState.song_stopAt = sd.song_length;
+    if (mSeqState.song_startAt > mSeqState.song_stopAt)
+        mSeqState.song_startAt = 0;
+    set_speed(sd.song_delay);
 }
 //------------------------------------------------------------------------------
 
 
 bool OplController::loadInstrument(const std::string& filename, uint8_t channel)
 {
-    if (channel > FMS_MAX_CHANNEL)
+    if (channel >= getChipChannels())
         return false;
 
     std::ifstream file(filename, std::ios::binary);
@@ -632,7 +1121,7 @@ bool OplController::loadInstrument(const std::string& filename, uint8_t channel)
 //------------------------------------------------------------------------------
 bool OplController::saveInstrument(const std::string& filename, uint8_t channel)
 {
-    if (channel > FMS_MAX_CHANNEL)
+    if (channel >= getChipChannels())
         return false;
     // std::ios::binary is essential to prevent CRLF translation on Windows
     std::ofstream file(filename, std::ios::binary);
@@ -651,8 +1140,52 @@ bool OplController::saveInstrument(const std::string& filename, uint8_t channel)
     return false;
 }
 //------------------------------------------------------------------------------
+bool OplController::loadInstrument4Op(const std::string& filename, uint8_t channel)
+{
+    const int bit = getFourOpBit(channel);
+    if (!mOpl3Mode || bit < 0 || channel % 9 >= 3)
+        return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    uint8_t instrumentData[48];
+    file.read(reinterpret_cast<char*>(instrumentData), 48);
+    if (file.gcount() != 48) {
+        Log("ERROR: %s: a .fm4 needs 48 bytes, got %ld", filename.c_str(), (long)file.gcount());
+        return false;
+    }
+
+    // operator 1 / 2 on the first channel, 3 / 4 on its partner (+3)
+    setInstrument(channel, instrumentData);
+    setInstrument(channel + 3, instrumentData + 24);
+    setInstrumentNameInCache(channel, filename.c_str());
+    setInstrumentNameInCache(channel + 3, filename.c_str());
+    return setFourOpMask(mFourOpMask | (1 << bit));
+}
+//------------------------------------------------------------------------------
+bool OplController::saveInstrument4Op(const std::string& filename, uint8_t channel)
+{
+    if (!mOpl3Mode || getFourOpBit(channel) < 0 || channel % 9 >= 3)
+        return false;
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(getInstrument(channel)), 24);
+    file.write(reinterpret_cast<const char*>(getInstrument(channel + 3)), 24);
+
+    if (file.good()) {
+        setInstrumentNameInCache(channel, filename.c_str());
+        setInstrumentNameInCache(channel + 3, filename.c_str());
+        return true;
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
 void OplController::replaceSongNotes(SongDataFMS& sd, uint8_t targetChannel, int16_t oldNote, int16_t newNote) {
-    if (targetChannel > FMS_MAX_CHANNEL)
+    if (targetChannel >= sd.getChannelCount())
         return;
 
     int count = 0;
@@ -660,19 +1193,20 @@ void OplController::replaceSongNotes(SongDataFMS& sd, uint8_t targetChannel, int
     // Start at 0, end before song_length
     for (int i = 0; i < sd.song_length; ++i) {
 
-        int16_t currentNote = sd.song[i][targetChannel];
+        int16_t currentNote = sd.getNote(i, targetChannel);
 
-        // DEBUG: This will now show the actual notes in memory
+        #ifdef FM_DEBUG
         if (i < 10) { // Limit debug output to first 10 ticks to avoid lag
             printf("remap: tick:%d, chan:%d, note:%d\n", i, targetChannel, currentNote);
         }
+        #endif
 
         if (currentNote == oldNote) {
-            sd.song[i][targetChannel] = newNote;
+            sd.setNote(i, targetChannel, newNote);
             count++;
         }
     }
-    printf("REMAPPER: Replaced %d instances of note %d with %d.\n", count, oldNote, newNote);
+    Log("INFO: Replaced %d instances of note %d with %d.", count, oldNote, newNote);
 }
 //------------------------------------------------------------------------------
 // enum class RenderMode {
@@ -682,7 +1216,8 @@ void OplController::replaceSongNotes(SongDataFMS& sd, uint8_t targetChannel, int
 //     SB_ORIGINAL, // 2.8kHz (Muffled+)
 //     ADLIB_GOLD,  // 16kHz (Hi-Fi)
 //     CLONE_CARD,  // 8kHz + No Blending
-//     MODERN_LPF   // 12kHz
+//     MODERN_LPF,  // 12kHz
+//     SINC         // band limited polyphase resampler (Hi-Fi)
 // };
 //
 
@@ -690,6 +1225,7 @@ void OplController::setRenderMode(RenderMode mode) {
     mRenderMode = mode;
     float cutoff = 20000.0f;
     mRenderUseBlending = true;
+    mRenderUseSinc = false;
     mRenderGain = 1.0f; // Default
 
     switch (mode) {
@@ -720,65 +1256,519 @@ void OplController::setRenderMode(RenderMode mode) {
             mRenderUseBlending = false;
             mRenderGain = 0.9f;  // Often "thinner" and quieter
             break;
+        case RenderMode::SINC:
+            cutoff = 20000.0f;
+            mRenderUseBlending = false;
+            mRenderUseSinc = true;
+            break;
     }
 
     // Recalculate Alpha
+    // the filter runs on the chip samples, this does not follow the output rate
     float dt = 1.0f / 44100.0f;
     float rc = 1.0f / (2.0f * M_PI * cutoff);
     mRenderAlpha = (cutoff >= 20000.0f) ? 1.0f : (dt / (rc + dt));
 }
 //------------------------------------------------------------------------------
 void OplController::fillBuffer(int16_t* buffer, int total_frames) {
-    double step = m_step;
-    double current_pos = m_pos;
+    fillBlock(reinterpret_cast<uint8_t*>(buffer), OplOutputSpec::Format::S16, total_frames);
+}
+//------------------------------------------------------------------------------
+void OplController::fillBuffer(float* buffer, int total_frames) {
+    fillBlock(reinterpret_cast<uint8_t*>(buffer), OplOutputSpec::Format::F32, total_frames);
+}
+//------------------------------------------------------------------------------
+void OplController::fillBlock(uint8_t* buffer, OplOutputSpec::Format format, int total_frames) {
+    ChipOwnerScope owner(this);
+    mFillFormat = format;
+
+    // publish the render clock for commandTimestamp
+    mBlockStartNs.store(nowNs(), std::memory_order_release);
+    mBlockFrames.store(total_frames, std::memory_order_release);
+    mBlockStartFrame.store(mRenderFrame, std::memory_order_release);
+
+    adoptPublishedSong();
 
-    for (int i = 0; i < total_frames; i++) {
-        // --- SEQUENCER ---
-        if (mSeqState.playing && mSeqState.current_song) {
-            mSeqState.sample_accumulator += 1.0;
+    int i = 0;
+    while (i < total_frames) {
+        // --- EVENTS AT FRAME i: GUI commands, then the sequencer ---
+        drainCommands(mRenderFrame + i);
+
+        bool sequencing = mSeqState.playing && mSeqState.current_song && mSeqState.samples_per_tick > 0;
+        if (sequencing) {
+            mSeqState.sample_accumulator += 1;
             while (mSeqState.sample_accumulator >= mSeqState.samples_per_tick) {
                 mSeqState.sample_accumulator -= mSeqState.samples_per_tick;
                 this->tickSequencer();
             }
+            // the tick may have stopped the song
+            sequencing = mSeqState.playing;
+        }
+
+        // --- RUN UNTIL THE NEXT EVENT ---
+        int run = total_frames - i;
+        if (sequencing)
+            run = std::min(run, mSeqState.samples_per_tick - mSeqState.sample_accumulator);
+
+        if (const OplCommand* cmd = mCommands.peek()) {
+            uint64_t now = mRenderFrame + i;
+            uint64_t untilCmd = (cmd->frame > now) ? cmd->frame - now : 1;
+            run = (int)std::min<uint64_t>(run, untilCmd);
         }
 
-        // --- RENDER ---
-        while (current_pos <= i) {
-            // Save for blending
-            mRender_prev_l = mOutput.data[0];
-            mRender_prev_r = mOutput.data[1];
+        renderRun(buffer, i, run);
+
+        // the first frame of the run was counted above
+        if (sequencing)
+            mSeqState.sample_accumulator += run - 1;
+
+        i += run;
+    }
+    m_pos -= total_frames;
+    mRenderFrame += total_frames;
+}
+//------------------------------------------------------------------------------
+// Block renderer. Each chunk runs as separate passes over contiguous buffers:
+// schedule (which chip sample feeds which frame), one bulk generate,
+// low pass filter on the chip samples and resample + gain to the output.
+// m_pos is relative to the start of the block while fillBuffer is running.
+void OplController::renderRun(uint8_t* buffer, int first, int count) {
+    if (mRenderUseSinc) {
+        renderRunSinc(buffer, first, count);
+        return;
+    }
+    mSincActive = false;
+
+    const int end = first + count;
+
+    int i = first;
+    while (i < end) {
+        // 1. SCHEDULE
+        int frames = 0;
+        uint32_t needed = scheduleChunk(i, end, frames);
+
+        // 2. GENERATE behind the previous and current sample
+        mChipBuffer[0].data[0] = mRender_prev_l;
+        mChipBuffer[0].data[1] = mRender_prev_r;
+        mChipBuffer[1] = mOutput;
+        generateChips(needed);
+
+        // 3. FILTER
+        filterChunk(mChipBuffer + 2, needed);
+
+        // 4. RESAMPLE + GAIN
+        resampleChunk(buffer + i * OplOutputSpec::frameBytes(mFillFormat), frames);
+
+        // keep the last two samples for the next chunk
+        mRender_prev_l = mChipBuffer[needed].data[0];
+        mRender_prev_r = mChipBuffer[needed].data[1];
+        mOutput = mChipBuffer[needed + 1];
 
-            mChip->generate(&mOutput);
+        i += frames;
+    }
+}
+//------------------------------------------------------------------------------
+// RenderMode::SINC: generate exactly the chip samples the polyphase filter
+// needs for the chunk, then gain + clamp with the post process kernel.
+void OplController::renderRunSinc(uint8_t* buffer, int first, int count) {
+    if (!mSincActive) {
+        mSinc.reset();
+        mSincActive = true;
+    }
+
+    const int end = first + count;
+    int i = first;
+    while (i < end) {
+        uint32_t frames = std::min<uint32_t>(end - i, OPL_RENDER_CHUNK_FRAMES);
+        frames = std::min(frames, mSinc.framesFor(OPL_CHIP_CHUNK_SAMPLES));
+        const uint32_t needed = mSinc.inputNeeded(frames);
+        float* in = needed > 0 ? mSinc.pushPtr(needed) : nullptr;
+
+        // not configured or no room for the input, framesFor should prevent
+        // both: silence for the rest, the filter starts over on the next run
+        if (frames == 0 || (needed > 0 && !in)) {
+            const uint32_t frameBytes = OplOutputSpec::frameBytes(mFillFormat);
+            std::memset(buffer + i * frameBytes, 0, (size_t)(end - i) * frameBytes);
+            mSincActive = false;
+            break;
+        }
+
+        if (needed > 0) {
+            generateChips(needed);
+            filterChunk(mChipBuffer + 2, needed);
 
-            // Apply Filter (Alpha 1.0 means no effect)
-            if (mRenderAlpha < 1.f) {
-                mRender_lpf_l += mRenderAlpha * (static_cast<float>(mOutput.data[0]) - mRender_lpf_l);
-                mRender_lpf_r += mRenderAlpha * (static_cast<float>(mOutput.data[1]) - mRender_lpf_r);
-                mOutput.data[0] = static_cast<int16_t>(mRender_lpf_l);
-                mOutput.data[1] = static_cast<int16_t>(mRender_lpf_r);
+            for (uint32_t k = 0; k < needed; k++) {
+                in[k * 2 + 0] = static_cast<float>(mChipBuffer[k + 2].data[0]);
+                in[k * 2 + 1] = static_cast<float>(mChipBuffer[k + 2].data[1]);
             }
-            current_pos += step;
+            mSinc.commitPush(needed);
+
+            // keep the blend state for a switch back to the other modes
+            mRender_prev_l = mChipBuffer[needed].data[0];
+            mRender_prev_r = mChipBuffer[needed].data[1];
+            mOutput = mChipBuffer[needed + 1];
         }
 
-        // --- OUTPUT ---
+        mSinc.process(mBlendCur, frames);
+        postProcessChunk(buffer + i * OplOutputSpec::frameBytes(mFillFormat), frames);
 
-        if (mRenderUseBlending) {
-            double fraction = current_pos - i;
+        i += frames;
+    }
+    // the blend clock continues at the next frame
+    m_pos = end;
+}
+//------------------------------------------------------------------------------
+// The workers start on the chip samples while this thread renders chip 0,
+// then all of them are summed in one pass. Without extra chips this is the
+// single chip generate.
+// The render thread never sleeps on a worker: a chip whose worker has not
+// started when chip 0 is done is generated here, only a chip already being
+// generated is waited for (at most one chunk of one chip).
+void OplController::generateChips(uint32_t samples) {
+    if (samples == 0)
+        return;
 
-            // Calculate blended sample in floating point for precision
-            double blended_l = (mRender_prev_l * fraction + mOutput.data[0] * (1.0 - fraction));
-            double blended_r = (mRender_prev_r * fraction + mOutput.data[1] * (1.0 - fraction));
+    OplChip::output_data* out = mChipBuffer + 2;
+    const uint32_t extraCount = (uint32_t)mExtraChips.size();
+    if (extraCount == 0) {
+        mChip->generate(out, samples);
+        return;
+    }
 
-            // Apply gain and clamp
-            buffer[i * 2 + 0] = static_cast<int16_t>(std::clamp(blended_l * mRenderGain, -32768.0, 32767.0));
-            buffer[i * 2 + 1] = static_cast<int16_t>(std::clamp(blended_r * mRenderGain, -32768.0, 32767.0));
-        } else {
-            // Apply gain and clamp even for Raw mode
-            buffer[i * 2 + 0] = static_cast<int16_t>(std::clamp(mOutput.data[0] * mRenderGain, -32768.0f, 32767.0f));
-            buffer[i * 2 + 1] = static_cast<int16_t>(std::clamp(mOutput.data[1] * mRenderGain, -32768.0f, 32767.0f));
+    // waking a worker costs more than a short chunk
+    const bool parallel = mParallelChips && samples >= OPL_PARALLEL_MIN_SAMPLES;
+    if (parallel) {
+        mWorkSamples = samples;
+        for (auto& extra : mExtraChips)
+            extra->job.store(JOB_QUEUED, std::memory_order_release);
+        mWorkTicket.fetch_add(1, std::memory_order_release);
+        mWorkTicket.notify_all();
+    }
+
+    mChip->generate(out, samples);
+
+    if (parallel) {
+        for (auto& extra : mExtraChips) {
+            if (!claimChip(*extra))
+                continue;
+            extra->chip->generate(extra->buffer.get(), samples);
+            extra->job.store(JOB_DONE, std::memory_order_release);
+            mChipsTakenOver.fetch_add(1, std::memory_order_relaxed);
         }
+        for (auto& extra : mExtraChips)
+            while (extra->job.load(std::memory_order_acquire) != JOB_DONE)
+                std::this_thread::yield();
+    } else {
+        for (auto& extra : mExtraChips)
+            extra->chip->generate(extra->buffer.get(), samples);
+    }
+
+    const int32_t* sources[OPL_MAX_CHIPS];
+    for (uint32_t k = 0; k < extraCount; k++)
+        sources[k] = mExtraChips[k]->buffer[0].data;
+    mMixChips(out[0].data, sources, extraCount, samples * OplChip::OUTPUTS);
+}
+//------------------------------------------------------------------------------
+bool OplController::claimChip(ExtraChip& extra) {
+    uint8_t expected = JOB_QUEUED;
+    return extra.job.compare_exchange_strong(expected, JOB_RUNNING,
+                                             std::memory_order_acquire, std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+// A worker waking up late finds its chip taken over (or already the job of
+// the next chunk, which it may take as well).
+void OplController::chipWorker(ExtraChip* extra, uint32_t ticket) {
+    for (;;) {
+        mWorkTicket.wait(ticket, std::memory_order_acquire);
+        ticket = mWorkTicket.load(std::memory_order_acquire);
+        if (mWorkStop.load(std::memory_order_acquire))
+            return;
+
+        if (!claimChip(*extra))
+            continue;
+        extra->chip->generate(extra->buffer.get(), mWorkSamples);
+        extra->job.store(JOB_DONE, std::memory_order_release);
+    }
+}
+//------------------------------------------------------------------------------
+void OplController::startWorkers() {
+    // the ticket is taken here, a stop right after the start is not missed
+    const uint32_t ticket = mWorkTicket.load(std::memory_order_acquire);
+    for (auto& extra : mExtraChips)
+        extra->worker = std::thread(&OplController::chipWorker, this, extra.get(), ticket);
+}
+//------------------------------------------------------------------------------
+void OplController::stopWorkers() {
+    mWorkStop.store(true, std::memory_order_release);
+    mWorkTicket.fetch_add(1, std::memory_order_release);
+    mWorkTicket.notify_all();
+    for (auto& extra : mExtraChips)
+        if (extra->worker.joinable())
+            extra->worker.join();
+    mWorkStop.store(false, std::memory_order_release);
+}
+//------------------------------------------------------------------------------
+bool OplController::setChipCount(uint32_t chips) {
+    if (chips < 1 || chips > OPL_MAX_CHIPS) {
+        Log("ERROR: setChipCount: %u chips, 1..%u are supported", chips, OPL_MAX_CHIPS);
+        return false;
+    }
+
+    // the audio thread outputs silence meanwhile (try_lock)
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    ChipOwnerScope owner(this);
+
+    mVoices.configure(chips, getChipChannels());
+    dropLivePool();
+    if (chips == getChipCount())
+        return true;
+
+    stopWorkers();
+    const uint32_t oldCount = getChipCount();
+    mExtraChips.resize(chips - 1);
+    for (uint32_t chip = oldCount; chip < chips; chip++) {
+        auto& extra = mExtraChips[chip - 1];
+        extra = std::make_unique<ExtraChip>();
+        extra->chip = std::make_unique<OplChip>(extra->iface);
+        extra->buffer = std::make_unique<OplChip::output_data[]>(OPL_CHIP_CHUNK_SAMPLES);
+        if (mOpl3Mode)
+            applyOpl3Registers((uint8_t)chip);
+        for (uint32_t ch = 0; ch < getChipChannels(); ch++)
+            setInstrument(mVoices.voiceOf(chip, ch), sSilentInstrument);
+    }
+    startWorkers();
+    return true;
+}
+//------------------------------------------------------------------------------
+// NEW (0x105) opens bank 1 and the OPL3 features, 0x104 selects the 4-op
+// pairs. NEW goes first when switching on, last when switching off.
+void OplController::applyOpl3Registers(uint8_t chip) {
+    if (mOpl3Mode) {
+        writeChip(chip, 0x105, 0x01);
+        writeChip(chip, 0x104, chip == 0 ? mFourOpMask : 0);
+    } else {
+        writeChip(chip, 0x104, 0x00);
+        writeChip(chip, 0x105, 0x00);
+    }
+}
+//------------------------------------------------------------------------------
+void OplController::setOpl3Mode(bool value) {
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    ChipOwnerScope owner(this);
+    if (value == mOpl3Mode)
+        return;
+
+    // key off in the old channel layout
+    for (uint32_t voice = 0; voice < getVoiceCount(); voice++)
+        stopNote((int)voice);
+
+    mOpl3Mode = value;
+    mFourOpMask = 0;
+    mVoices.configure(getChipCount(), getChipChannels());
+    dropLivePool();
+
+    for (uint8_t chip = 0; chip < getChipCount(); chip++)
+        applyOpl3Registers(chip);
+
+    // C0 gets (or loses) the panning bits, bank 1 starts silent
+    for (uint32_t voice = 0; voice < getVoiceCount(); voice++) {
+        if (mVoices.locate(voice).channel >= OPL_CHIP_CHANNELS)
+            setInstrument((uint8_t)voice, sSilentInstrument);
+        else
+            applyInstrument((uint8_t)voice, getInstrument((uint8_t)voice));
+    }
+}
+//------------------------------------------------------------------------------
+// the claims are gone already (OplVoiceAllocator::configure)
+void OplController::dropLivePool() {
+    mLive.setPool(nullptr, 0);
+    mLiveChannel = -1;
+    mLiveClaimCount = 0;
+}
+//------------------------------------------------------------------------------
+void OplController::buildLivePool(int channel) {
+    stopLiveNotes();
+    for (uint32_t i = 0; i < mLiveClaimCount; i++)
+        mVoices.release(mLiveClaims[i]);
+    mLiveClaimCount = 0;
+
+    uint8_t instrument[24];
+    std::memcpy(instrument, getInstrument((uint8_t)channel), 24);
+
+    uint16_t pool[OplLiveVoices::MAX_VOICES];
+    uint32_t count = 0;
+    pool[count++] = (uint16_t)channel;
+
+    // drums and 4-op pairs have no second voice which sounds the same
+    auto isOwnSound = [this](int ch) {
+        const int bit = getFourOpBit(ch);
+        return (!mMelodicMode && ch >= 6 && ch <= FMS_MAX_CHANNEL)
+            || (mOpl3Mode && bit >= 0 && (mFourOpMask & (1 << bit)));
+    };
+    if (!isOwnSound(channel)) {
+        // a playing song owns its channels
+        if (!mSeqState.playing) {
+            for (int ch = FMS_MIN_CHANNEL; ch < (int)getChipChannels(); ch++) {
+                if (ch == channel || isOwnSound(ch))
+                    continue;
+                if (std::memcmp(getInstrument((uint8_t)ch), instrument, 24) == 0)
+                    pool[count++] = (uint16_t)ch;
+            }
+        }
+        while (mLiveClaimCount < mLivePolyphony && count < OplLiveVoices::MAX_VOICES) {
+            const int voice = mVoices.claim();
+            if (voice < 0)
+                break;
+            setInstrument((uint8_t)voice, instrument);
+            mLiveClaims[mLiveClaimCount++] = (uint16_t)voice;
+            pool[count++] = (uint16_t)voice;
+        }
+    }
+
+    mLive.setPool(pool, count);
+    mLiveChannel = channel;
+    mLiveSongPlaying = mSeqState.playing;
+    mLiveRevision = mInstrumentRevision;
+}
+//------------------------------------------------------------------------------
+int OplController::playLiveNote(int channel, int noteIndex) {
+    if (channel < FMS_MIN_CHANNEL || channel >= (int)getChipChannels() || noteIndex <= 0 || noteIndex >= 85)
+        return -1;
+
+    if (channel != mLiveChannel || mLiveRevision != mInstrumentRevision || mLiveSongPlaying != mSeqState.playing)
+        buildLivePool(channel);
+
+    // playNoteDOS keys off first: a stolen or retriggered voice restarts
+    const OplLiveVoices::NoteOn on = mLive.noteOn(noteIndex);
+    if (on.voice >= 0)
+        playNoteDOS(on.voice, noteIndex);
+    return on.voice;
+}
+//------------------------------------------------------------------------------
+void OplController::stopLiveNote(int channel, int noteIndex) {
+    if (channel != mLiveChannel)
+        return;
+    const int voice = mLive.noteOff(noteIndex);
+    if (voice >= 0)
+        stopNote(voice);
+}
+//------------------------------------------------------------------------------
+void OplController::stopLiveNotes() {
+    while (mLive.getOldestHeldVoice() >= 0)
+        stopNote(mLive.noteOff(mLive.getOldestHeldNote()));
+}
+//------------------------------------------------------------------------------
+void OplController::setLivePolyphony(uint32_t voices) {
+    mLivePolyphony = std::min<uint32_t>(voices, OplLiveVoices::MAX_VOICES - 1);
+    mLiveChannel = -1; // rebuilt (and the claims returned) with the next note
+}
+//------------------------------------------------------------------------------
+bool OplController::setFourOpMask(uint8_t mask) {
+    mask &= 0x3F;
+    if (mask == mFourOpMask)
+        return true;
+    if (!mOpl3Mode) {
+        Log("ERROR: setFourOpMask: 4-op pairs (0x%02X) need OPL3 mode", mask);
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    ChipOwnerScope owner(this);
+
+    // the second channel of a new pair stops playing on its own
+    for (int bit = 0; bit < 6; bit++)
+        if ((mask & ~mFourOpMask) & (1 << bit))
+            stopNote((bit / 3) * 9 + bit % 3 + 3);
+
+    mFourOpMask = mask;
+    writeChip(0, 0x104, mFourOpMask);
+    return true;
+}
+//------------------------------------------------------------------------------
+// Fills mResampleIndex / mBlendFrac for the frames [first, end) which fit
+// into one bulk generate. Returns the number of chip samples needed.
+uint32_t OplController::scheduleChunk(int first, int end, int& frames) {
+    const double step = m_step;
+    double current_pos = m_pos;
+    uint32_t needed = 0;
+
+    frames = 0;
+    while (first + frames < end && frames < (int)OPL_RENDER_CHUNK_FRAMES) {
+        const int f = first + frames;
+        uint32_t n = 0;
+        double q = current_pos;
+        while (q <= f) { n++; q += step; }
+        if (needed + n > OPL_CHIP_CHUNK_SAMPLES)
+            break;
+        needed += n;
+        current_pos = q;
+
+        mResampleIndex[frames] = needed + 1;
+        mBlendFrac[frames * 2 + 0] = mBlendFrac[frames * 2 + 1] = current_pos - f;
+        frames++;
+    }
+    m_pos = current_pos;
+    return needed;
+}
+//------------------------------------------------------------------------------
+void OplController::filterChunk(OplChip::output_data* samples, uint32_t count) {
+    // Alpha 1.0 means no effect
+    if (mRenderAlpha >= 1.f)
+        return;
+
+    const float alpha = mRenderAlpha;
+    float lpf_l = mRender_lpf_l;
+    float lpf_r = mRender_lpf_r;
+    for (uint32_t k = 0; k < count; k++) {
+        lpf_l += alpha * (static_cast<float>(samples[k].data[0]) - lpf_l);
+        lpf_r += alpha * (static_cast<float>(samples[k].data[1]) - lpf_r);
+        samples[k].data[0] = static_cast<int16_t>(lpf_l);
+        samples[k].data[1] = static_cast<int16_t>(lpf_r);
+    }
+    mRender_lpf_l = lpf_l;
+    mRender_lpf_r = lpf_r;
+}
+//------------------------------------------------------------------------------
+void OplController::resampleChunk(uint8_t* out, int frames) {
+    const OplChip::output_data* line = mChipBuffer;
+
+    // gather the chip samples, then blend + gain + clamp in one kernel pass
+    if (mRenderUseBlending) {
+        for (int j = 0; j < frames; j++) {
+            const uint32_t c = mResampleIndex[j];
+            // the previous sample is truncated to int16 like on the old path
+            mBlendPrev[j * 2 + 0] = static_cast<int16_t>(line[c - 1].data[0]);
+            mBlendPrev[j * 2 + 1] = static_cast<int16_t>(line[c - 1].data[1]);
+            mBlendCur[j * 2 + 0] = static_cast<float>(line[c].data[0]);
+            mBlendCur[j * 2 + 1] = static_cast<float>(line[c].data[1]);
+        }
+    } else {
+        // Raw: no blend, gain and clamp still apply
+        for (int j = 0; j < frames; j++) {
+            const uint32_t c = mResampleIndex[j];
+            mBlendCur[j * 2 + 0] = static_cast<float>(line[c].data[0]);
+            mBlendCur[j * 2 + 1] = static_cast<float>(line[c].data[1]);
+        }
+    }
+    postProcessChunk(out, frames);
+}
+//------------------------------------------------------------------------------
+void OplController::postProcessChunk(uint8_t* out, int frames) {
+    // raw and sinc only fill mBlendCur
+    if (mFillFormat == OplOutputSpec::Format::F32) {
+        // float output keeps the headroom, no int16 clamp
+        float* dst = reinterpret_cast<float*>(out);
+        if (mRenderUseBlending)
+            OplPostProcess::blendGainF32(mBlendPrev, mBlendCur, mBlendFrac, mRenderGain, dst, frames * 2);
+        else
+            OplPostProcess::gainF32(mBlendCur, mRenderGain, dst, frames * 2);
+    } else {
+        int16_t* dst = reinterpret_cast<int16_t*>(out);
+        if (mRenderUseBlending)
+            mBlendGain(mBlendPrev, mBlendCur, mBlendFrac, mRenderGain, dst, frames * 2);
+        else
+            mGain(mBlendCur, mRenderGain, dst, frames * 2);
     }
-    m_pos = current_pos - total_frames;
 }
 
 //------------------------------------------------------------------------------
@@ -793,8 +1783,10 @@ void OplController::tickSequencer() {
     // if (mSeqState.song_counter < s.song_length)
     if (mSeqState.song_needle < mSeqState.song_stopAt)
     {
-        for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++) {
-            int16_t raw_note = s.song[mSeqState.song_needle][ch];
+        int16_t row[OplPatternStore::CHANNELS];
+        s.notes.getRow(mSeqState.song_needle, row);
+        for (int ch = FMS_MIN_CHANNEL; ch < s.getChannelCount(); ch++) {
+            int16_t raw_note = row[ch];
 
             // Update UI/Debug state
             mSeqState.last_notes[ch + 1] = raw_note;
@@ -831,8 +1823,9 @@ void OplController::consoleSongOutput(bool useNumbers)
         // incremented in the callback after the note was played.
         printf("Step %3d: ", mSeqState.song_needle - 1);
 
-        // Loop through Tracker Columns 1 to 9
-        for (int ch = 1; ch <= 9; ch++) {
+        // Loop through Tracker Columns 1 to 9 (18 for OPL3 songs)
+        const int channels = mSeqState.current_song ? mSeqState.current_song->getChannelCount() : FMS_MAX_CHANNEL + 1;
+        for (int ch = 1; ch <= channels; ch++) {
             int16_t note = mSeqState.last_notes[ch];
 
             if (note == -1) {
@@ -843,7 +1836,7 @@ void OplController::consoleSongOutput(bool useNumbers)
                 if ( useNumbers )
                     printf("%4d ", note); // The actual note index
                 else
-                    printf("%4s ", getNoteNameFromId(note).c_str());
+                    printf("%4s ", getNoteNameFromId(note));
             }
         }
         printf("\n");
@@ -851,106 +1844,18 @@ void OplController::consoleSongOutput(bool useNumbers)
     }
 }
 //------------------------------------------------------------------------------
-std::string OplController::getNoteNameFromId(int noteID) {
-    // 0 is the padding/empty entry in your array
-    if (noteID == 0 || noteID > 84) {
-        return "...";
-    } else if (noteID < 0) {
+const char* OplController::getNoteNameFromId(int noteID)
+{
+    if (noteID < 0)
         return "===";
-    }
-
-
-
-    // The note names in the order of your chromatic table (C, C#, D, D#...)
-    static const char* noteNames[] = {
-        "C-", "C#", "D-", "D#", "E-", "F-",
-        "F#", "G-", "G#", "A-", "A#", "B-"
-    };
-
-    // 1. Calculate the Octave (I-VIII)
-    // IDs 1-12 = Octave 1, 13-24 = Octave 2, etc.
-    int octave = ((noteID ) / 12 )  + 1;
-
-    int positionInOctave = (noteID - 1) % 12;
-
-    // Note: If your myDosScale matches the DOCUMENT numbers exactly:
-    // 1=D, 2=E, 3=F, 4=G, 5=A, 6=H, 7=C#, 8=D#, 9=F#, 10=G#, 11=A#, 12=C
-    static const int documentToMusicalMap[] = {
-        2,  // 1 -> D
-        4,  // 2 -> E
-        5,  // 3 -> F
-        7,  // 4 -> G
-        9,  // 5 -> A
-        11, // 6 -> H
-        1,  // 7 -> C#
-        3,  // 8 -> D#
-        6,  // 9 -> F#
-        8,  // 10 -> G#
-        10, // 11 -> A#
-        0   // 12 -> C
-    };
-
-    int noteIndex = documentToMusicalMap[positionInOctave];
-
-    return std::string(noteNames[noteIndex]) + std::to_string(octave);
+    if (noteID >= OplNoteTable::DOS_NOTES)
+        return "...";
+    return OplNoteTable::NAMES[noteID].data();
 }
 //------------------------------------------------------------------------------
-int OplController::getIdFromNoteName(std::string name)
+int OplController::getIdFromNoteName(std::string_view name)
 {
-
-    if (name.length() < 3 || name == "...")
-        return 0;
-    else if (name == "===")
-        return -1;
-
-    static const std::vector<std::string> noteNames = {
-        "C-", "C#", "D-", "D#", "E-", "F-",
-        "F#", "G-", "G#", "A-", "A#", "B-"
-    };
-
-    // The reverse map of your documentToMusicalMap
-    // Maps musical index (0=C, 1=C#, 2=D...) back to array position (0-11)
-    static const int musicalToPositionMap[] = {
-        11, // C- (0) -> index 11
-        6,  // C# (1) -> index 6
-        0,  // D- (2) -> index 0
-        7,  // D# (3) -> index 7
-        1,  // E- (4) -> index 1
-        2,  // F- (5) -> index 2
-        8,  // F# (6) -> index 8
-        3,  // G- (7) -> index 3
-        9,  // G# (8) -> index 9
-        4,  // A- (9) -> index 4
-        10, // A# (10)-> index 10
-        5   // B- (11)-> index 5
-    };
-
-    std::string notePart = name.substr(0, 2);
-    int octave;
-    try {
-        octave = std::stoi(name.substr(2));
-    } catch (...) { return 0; }
-
-    // Find the musical index (0-11)
-    int musicalIndex = -1;
-    for (int i = 0; i < 12; ++i) {
-        if (noteNames[i] == notePart) {
-            musicalIndex = i;
-            break;
-        }
-    }
-    if (musicalIndex == -1) return 0;
-
-    int positionInOctave = musicalToPositionMap[musicalIndex];
-
-    // THE REVERSE MATH:
-    // In your working function: octave = ((noteID - 1) / 12) + 1 + (noteIndex == 0 ? 1 : 0)
-    // If the note is C (index 0), the octave was incremented, so we subtract it back.
-    int adjustedOctave = (musicalIndex == 0) ? (octave - 1) : octave;
-
-    int noteID = ((adjustedOctave - 1) * 12) + (positionInOctave + 1);
-
-    return (noteID >= 1 && noteID <= 84) ? noteID : 0;
+    return OplNoteTable::parseName(name.data(), name.size());
 }
 //------------------------------------------------------------------------------
 void OplController::resetInstrument(uint8_t channel)
@@ -1021,104 +1926,136 @@ void OplController::loadInstrumentPreset()
 void OplController::loadInstrumentPresetSyncSongName(SongDataFMS& sd)
 {
     loadInstrumentPreset();
-    for ( U8 ch = FMS_MIN_CHANNEL;  ch <= FMS_MAX_CHANNEL; ch++ )
+    for ( uint8_t ch = FMS_MIN_CHANNEL;  ch <= FMS_MAX_CHANNEL; ch++ )
     {
         SetInstrumentName(sd,ch, getInstrumentNameFromCache(ch).c_str());
     }
 }
 
 //------------------------------------------------------------------------------
-bool OplController::exportToWav(SongDataFMS& sd, const std::string& filename, float* progressOut)
+bool OplController::exportToWav(const SongDataFMS& sd, const std::string& filename, std::atomic<float>* progressOut)
+{
+    std::unique_ptr<OplController> engine = cloneOffline();
+    return engine->renderToWav(sd, filename, progressOut);
+}
+//------------------------------------------------------------------------------
+std::unique_ptr<OplController> OplController::cloneOffline() const
+{
+    auto engine = std::make_unique<OplController>();
+    engine->copySoundState(*this);
+    return engine;
+}
+//------------------------------------------------------------------------------
+void OplController::copySoundState(const OplController& source)
+{
+    // the source is live: its render thread writes the shadow registers and
+    // applies the queued commands under this lock, between two blocks the
+    // state is complete (no half set instrument, no lone A0 / B0)
+    std::lock_guard<std::recursive_mutex> sourceLock(source.mDataMutex);
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
+    ChipOwnerScope owner(this);
+
+    std::memcpy(m_instrument_cache, source.m_instrument_cache, sizeof(m_instrument_cache));
+    std::memcpy(m_instrument_name_cache, source.m_instrument_name_cache, sizeof(m_instrument_name_cache));
+    mMelodicMode = source.mMelodicMode;
+    mTuning = source.mTuning;
+    mDosNotes = source.mDosNotes;
+    mChromaticNotes = source.mChromaticNotes;
+    setRenderMode(source.mRenderMode);
+    // the export has its own format, not the one of the device
+    mExportSpec = source.mExportSpec;
+    applyOutputSpec(source.mExportSpec);
+    mParallelChips = source.mParallelChips;
+    mOpl3Mode = source.mOpl3Mode;
+    mFourOpMask = source.mFourOpMask;
+    setChipCount(source.getChipCount()); // also renumbers the voices
+    for (size_t k = 0; k < mExtraChips.size(); k++)
+        std::memcpy(mExtraChips[k]->instruments, source.mExtraChips[k]->instruments, sizeof(ExtraChip::instruments));
+
+    // replay the register state without key on and without the timer / IRQ
+    // registers, in OPL3 mode NEW / 4-op first, then both banks
+    for (uint8_t chip = 0; chip < getChipCount(); chip++) {
+        auto copyReg = [&](uint16_t reg, uint8_t mask = 0xFF) {
+            writeChip(chip, reg, source.readShadowChip(chip, reg) & mask);
+        };
+        if (mOpl3Mode) {
+            copyReg(0x105);
+            copyReg(0x104);
+        }
+        copyReg(0x01);
+        copyReg(0x08);
+        for (uint16_t bank = 0; bank <= (mOpl3Mode ? 0x100 : 0); bank += 0x100) {
+            for (uint16_t reg = 0x20; reg <= 0x95; reg++)
+                copyReg(bank + reg);
+            for (uint16_t reg = 0xA0; reg <= 0xA8; reg++)
+                copyReg(bank + reg);
+            for (uint16_t reg = 0xB0; reg <= 0xB8; reg++)
+                copyReg(bank + reg, 0x1F); // key off
+            for (uint16_t reg = 0xC0; reg <= 0xC8; reg++)
+                copyReg(bank + reg);
+            for (uint16_t reg = 0xE0; reg <= 0xF5; reg++)
+                copyReg(bank + reg);
+        }
+        copyReg(0xBD, 0xE0); // AM / vibrato depth and rhythm mode, no drums
+    }
+}
+//------------------------------------------------------------------------------
+bool OplController::renderToWav(SongSnapshot song, const std::string& filename, std::atomic<float>* progressOut)
 {
+    if (!song)
+        return false;
+    const SongDataFMS& sd = *song;
 
-    // unbind the audio stream
-    SDL_PauseAudioStreamDevice(mStream);
-    SDL_SetAudioStreamGetCallback(mStream, NULL, NULL);
+    std::lock_guard<std::recursive_mutex> lock(mDataMutex);
 
+    if (isLive()) {
+        Log("ERROR: renderToWav needs an offline controller, see cloneOffline");
+        return false;
+    }
 
     //start the song
-    start_song( sd, false, 0, -1);
-
-    // calculate duration based on the speed
-    uint32_t total_ticks = sd.song_length * 1; // using your 1 tick per step logic
-    uint32_t total_samples = total_ticks * mSeqState.samples_per_tick;
-    double durationInSeconds = (double)total_samples / 44100.0;
-
-
-
-    int sampleRate = 44100; // Match your chip's output rate
-    int totalFrames = durationInSeconds * sampleRate;
-    int chunkSize = 4096;   // Process in small batches
+    start_song(std::move(song), false, 0, -1);
+
+    // calculate duration based on the speed: one tick per row, in 64 bit
+    // (65535 rows at delay 255 are ~8e9 frames)
+    const OplOutputSpec spec = mOutputSpec;
+    const uint64_t totalFrames = (uint64_t)sd.song_length * (uint64_t)mSeqState.samples_per_tick;
+    const uint32_t chunkSize = 4096;   // Process in small batches
+
+    if (totalFrames > OplWavWriter::getMaxFrames(spec)) {
+        Log("ERROR: Song too long for a wav file: %.1f minutes, a wav of %d Hz holds at most %.1f minutes",
+            (double)totalFrames / spec.rate / 60.0, spec.rate,
+            (double)OplWavWriter::getMaxFrames(spec) / spec.rate / 60.0);
+        return false;
+    }
 
-    std::vector<int16_t> exportBuffer(totalFrames * 2); // Stereo
-    int framesProcessed = 0;
+    // render and write in fixed chunks, memory does not grow with the song
+    OplWavWriter writer;
+    bool result = writer.open(filename, spec);
+    std::vector<uint8_t> chunkBuffer((size_t)chunkSize * spec.bytesPerFrame());
+    uint64_t framesProcessed = 0;
 
     // Reset your sequencer state before starting
     mSeqState.sample_accumulator = 0;
     m_pos = 0;
 
-    while (framesProcessed < totalFrames) {
-        int remaining = totalFrames - framesProcessed;
-        int toWrite = std::min(chunkSize, remaining);
+    while (result && framesProcessed < totalFrames) {
+        uint32_t toWrite = (uint32_t)std::min<uint64_t>(chunkSize, totalFrames - framesProcessed);
 
-        // Fill the buffer starting at the current offset
-        this->fillBuffer(&exportBuffer[framesProcessed * 2], toWrite);
+        this->fillBlock(chunkBuffer.data(), spec.format, toWrite);
+        result = writer.write(chunkBuffer.data(), toWrite);
         framesProcessed += toWrite;
 
         if (progressOut) {
-            *progressOut = (float)framesProcessed / (float)total_samples;
+            progressOut->store((float)((double)framesProcessed / (double)totalFrames), std::memory_order_relaxed);
         }
     }
+    if (writer.isOpen())
+        result = writer.close() && result;
 
-    // rebind the audio stream!
-    SDL_SetAudioStreamGetCallback(mStream, OplController::audio_callback, this);
-    SDL_ResumeAudioStreamDevice(mStream);
-
-
-    // Now write exportBuffer to a wav file
-    return saveWavFile(filename, exportBuffer, sampleRate);
-}
-//------------------------------------------------------------------------------
-bool OplController::saveWavFile(const std::string& filename, const std::vector< int16_t >& data, int sampleRate) {
-    // Open the file for writing using SDL3's IO system
-    SDL_IOStream* io = SDL_IOFromFile(filename.c_str(), "wb");
-    if (!io) {
-        LogFMT("ERROR:Failed to open file for writing: %s", SDL_GetError());
-        return false;
-    }
-
-    uint32_t numChannels = 2; // Stereo as per your fillBuffer
-    uint32_t bitsPerSample = 16;
-    uint32_t dataSize = (uint32_t)(data.size() * sizeof(int16_t));
-    uint32_t fileSize = 36 + dataSize;
-    uint32_t byteRate = sampleRate * numChannels * (bitsPerSample / 8);
-    uint16_t blockAlign = (uint16_t)(numChannels * (bitsPerSample / 8));
-
-    // Write the 44-byte WAV Header
-    SDL_WriteIO(io, "RIFF", 4);
-    SDL_WriteU32LE(io, fileSize);
-    SDL_WriteIO(io, "WAVE", 4);
-    SDL_WriteIO(io, "fmt ", 4);
-    SDL_WriteU32LE(io, 16);          // Subchunk1Size (16 for PCM)
-    SDL_WriteU16LE(io, 1);           // AudioFormat (1 for PCM)
-    SDL_WriteU16LE(io, (uint16_t)numChannels);
-    SDL_WriteU32LE(io, (uint32_t)sampleRate);
-    SDL_WriteU32LE(io, byteRate);
-    SDL_WriteU16LE(io, blockAlign);
-    SDL_WriteU16LE(io, (uint16_t)bitsPerSample);
-    SDL_WriteIO(io, "data", 4);
-    SDL_WriteU32LE(io, dataSize);
-
-    // Write the actual PCM sample data
-    SDL_WriteIO(io, data.data(), dataSize);
-
-    // Close the stream
-    SDL_CloseIO(io);
-    LogFMT("Successfully exported {}", filename);
-
-
-
-    return true;
+    if (result)
+        LogFMT("Successfully exported {}", filename);
+    return result;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -7,13 +7,24 @@
 //-----------------------------------------------------------------------------
 
 #pragma once
-#include <SDL3/SDL.h>
-
 #include "ymfm.h"
 #include "ymfm_opl.h"
 
 #include "OplInterface.h"
-#include "errorlog.h"
+#include "OplRenderBlock.h"
+#include "OplCommandQueue.h"
+#include "OplPostProcess.h"
+#include "OplSincResampler.h"
+#include "OplOutputSpec.h"
+#include "OplAudioOutput.h"
+#include "OplAudioAllocations.h"
+#include "OplRenderStats.h"
+#include "OplLog.h"
+#include "OplPatternStore.h"
+#include "OplSnapshotExchange.h"
+#include "OplLiveVoices.h"
+#include "OplNoteTable.h"
+#include "OplVoiceAllocator.h"
 
 // for load:
 #include <fstream>
@@ -34,13 +45,38 @@
 #include <array>
 
 #include <mutex>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <thread>
 //------------------------------------------------------------------------------
 const float PLAYBACK_FREQUENCY = 90.0f;
 
+// minimum size of the render block in frames, see initController
+const uint32_t OPL_RENDER_BLOCK_FRAMES = 8192;
+
+// block renderer: chip samples per ymfm::generate call and output frames per pass
+const uint32_t OPL_CHIP_CHUNK_SAMPLES = 2048;
+const uint32_t OPL_RENDER_CHUNK_FRAMES = 1024;
+
 #define FMS_MIN_CHANNEL 0
 #define FMS_MAX_CHANNEL 8
-
+// OPL3 songs (.fm3): both register banks, channels 9..17 on bank 1
+#define FMS_OPL3_CHANNELS 18
+#define FMS_OPL3_MAX_CHANNEL 17
+
+// chips of one controller (see setChipCount), 9 channels each per
+// register bank
+const uint32_t OPL_MAX_CHIPS = OplVoiceAllocator::MAX_CHIPS;
+const uint32_t OPL_CHIP_CHANNELS = OplVoiceAllocator::CHANNELS_PER_CHIP;
+// below this many chip samples the extra chips render on the calling thread
+const uint32_t OPL_PARALLEL_MIN_SAMPLES = 256;
+
+// length limit of the DOS composer, longer songs are written in the same
+// layout but only load here
 #define FMS_MAX_SONG_LENGTH 1000
+// song_length is a word
+#define FMS_MAX_ROWS 65535
 //------------------------------------------------------------------------------
 // class OplController
 //------------------------------------------------------------------------------
@@ -56,7 +92,8 @@ public:
         SB_ORIGINAL, // 2.8kHz (Muffled+)
         ADLIB_GOLD,  // 16kHz (Hi-Fi)
         CLONE_CARD,  // 8kHz + No Blending
-        MODERN_LPF   // 12kHz
+        MODERN_LPF,  // 12kHz
+        SINC         // band limited polyphase resampler (Hi-Fi)
     };
     void setRenderMode(RenderMode mode);
     RenderMode getRenderMode() { return mRenderMode; }
@@ -64,6 +101,7 @@ private:
     RenderMode mRenderMode = RenderMode::RAW;
     float mRenderAlpha = 1.0f;
     bool mRenderUseBlending = false;
+    bool mRenderUseSinc = false;
     float mRenderGain = 1.0f; // Global gain to simulate hot Sound Blaster output
 
     // Filter and Blending states
@@ -75,49 +113,63 @@ public:
     struct SongDataFMS {
         // Pascal: array[1..9] of string[255] -> 10 slots to allow 1-based indexing
         // Index [channel][0] is the length byte.
-        uint8_t actual_ins[10][256];
+        // OPL3 songs use the slots up to 18
+        uint8_t actual_ins[FMS_OPL3_CHANNELS + 1][256] = {};
 
         // Pascal: array[1..9, 0..23] of byte
-        uint8_t ins_set[10][24];
+        uint8_t ins_set[FMS_OPL3_CHANNELS + 1][24] = {};
 
-        uint8_t song_delay;   // Pascal: byte
-        uint16_t song_length; // Pascal: word (16-bit)
+        uint8_t song_delay = 15;  // Pascal: byte
+        uint16_t song_length = 0; // Pascal: word (16-bit)
 
         // Pascal: array[1..1000, 1..9] of integer (16-bit signed)
-        int16_t song[FMS_MAX_SONG_LENGTH + 1][FMS_MAX_CHANNEL + 1];
+        // now patterns + order list, grows on demand (see OplPatternStore)
+        OplPatternStore notes;
+
+        // OPL3 extension (.fm3): 18 channels on both register banks.
+        // four_op holds the 4-op pairs (bits of register 0x104), a pair
+        // plays the notes of its first channel with the instruments of
+        // both channels as operators 1 / 2 and 3 / 4.
+        bool opl3 = false;
+        uint8_t four_op = 0;
+
+        int getChannelCount() const { return opl3 ? FMS_OPL3_CHANNELS : FMS_MAX_CHANNEL + 1; }
+
+        int16_t getNote(int row, int channel) const
+        {
+            if (row < 0 || channel < FMS_MIN_CHANNEL || channel >= getChannelCount())
+                return 0;
+            return notes.get((uint32_t)row, (uint32_t)channel);
+        }
+        bool setNote(int row, int channel, int16_t note)
+        {
+            if (row < 0 || channel < FMS_MIN_CHANNEL || channel >= getChannelCount())
+                return false;
+            return notes.set((uint32_t)row, (uint32_t)channel, note);
+        }
 
         // Initialization function
         void init() {
-            // 1. Zero out everything first for safety
-            std::memset(this, 0, sizeof(SongDataFMS));
-
-            // 2. Initialize Pascal Strings (actual_ins)
+            // 1. Zero out the Pascal part
             // In Pascal, a blank string has a length of 0 at index [0].
-            for (int ch = 0; ch <= FMS_MAX_CHANNEL; ++ch) {
-                actual_ins[ch][0] = 0; // Length = 0
-                // Optional: Initialize with a default name like "Empty"
-                // SetPascalString(ch, "Empty");
-            }
+            std::memset(actual_ins, 0, sizeof(actual_ins));
+            std::memset(ins_set, 0, sizeof(ins_set));
 
-            // 3. Set standard defaults
+            // 2. Set standard defaults
             song_delay = 15;
             song_length = 0;
+            opl3 = false;
+            four_op = 0;
 
-            // 4. Initialize Song Array
-            // If "0" is not a valid empty note in your tracker,
-            // initialize with -1 or your specific "empty" constant.
-            for (int i = 0; i <= FMS_MAX_SONG_LENGTH; ++i) {
-                for (int j = FMS_MIN_CHANNEL; j <= FMS_MAX_CHANNEL; ++j) {
-                    song[i][j] = 0;
-                }
-            }
+            // 3. Empty song, 0 is the empty note
+            notes.clear();
         }
 
         // Helper to get the Pascal string for C++ string (0..8 -> 1..9)
         std::string getInstrumentName(int channel)
         {
-            // Safety check for your 0..8 range
-            if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+            // Safety check for your 0..8 range (0..17 in OPL3 songs)
+            if (channel < FMS_MIN_CHANNEL || channel >= getChannelCount())
                 return "";
 
             // index [channel+1] selects the row (1..9)
@@ -130,7 +182,7 @@ public:
 
         // Helper to set a Pascal string from a C-string (0..8 -> 1..9)
         bool setInstrumentName(int channel, const char* name) {
-            if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+            if (channel < FMS_MIN_CHANNEL || channel >= getChannelCount())
                 return false;
 
             size_t len = std::strlen(name);
@@ -145,8 +197,24 @@ public:
 
             return true;
         }
+        // true if other is this version of the song (or a copy of it),
+        // the notes compare by revision
+        bool isSameVersion(const SongDataFMS& other) const
+        {
+            return notes.getRevision() == other.notes.getRevision()
+                && song_length == other.song_length && song_delay == other.song_delay
+                && opl3 == other.opl3 && four_op == other.four_op
+                && std::memcmp(actual_ins, other.actual_ins, sizeof(actual_ins)) == 0
+                && std::memcmp(ins_set, other.ins_set, sizeof(ins_set)) == 0;
+        }
     }; //stuct SongData
 
+    // Immutable version of a song for playback and export. The copy shares
+    // the note patterns with the original, editing the original afterwards
+    // only copies the patterns it touches.
+    using SongSnapshot = std::shared_ptr<const SongDataFMS>;
+    static SongSnapshot makeSnapshot(const SongDataFMS& sd) { return std::make_shared<const SongDataFMS>(sd); }
+
 
     struct InsParam {
         std::string name;
@@ -155,7 +223,11 @@ public:
 
     static const std::vector<InsParam> INSTRUMENT_METADATA; //Defined below
 
-    std::recursive_mutex mDataMutex;
+    // Only guards reset / load / export. Notes, instruments and silence
+    // from the GUI go through the lock free command queue. The audio
+    // thread only try_locks it and never waits. Mutable: cloneOffline
+    // locks the source while it copies it.
+    mutable std::recursive_mutex mDataMutex;
 
 
 
@@ -169,10 +241,11 @@ public:
 
         int samples_per_tick = 0;
         int sample_accumulator = 0;
-        const SongDataFMS* current_song = nullptr; // Pointer to the loaded song
+        const SongDataFMS* current_song = nullptr; // the playing snapshot
+        bool play_to_end = false; // song_stopAt follows song_length of a new version
 
         // see what it plays
-        int16_t last_notes[10]; // Stores the notes for channels 1-9
+        int16_t last_notes[FMS_OPL3_CHANNELS + 1]; // Stores the notes for channels 1-9 (1-18 OPL3)
         bool note_updated = false;
     };
 
@@ -181,6 +254,13 @@ public:
 protected:
     SequencerState mSeqState;
 
+private:
+    SongSnapshot mPlayingSong;  // owns mSeqState.current_song
+    OplSnapshotExchange<SongDataFMS> mSongExchange; // edits while playing, see publishSong
+
+    // audio thread: picks up a version from publishSong
+    void adoptPublishedSong();
+
 private:
 
     // using OplChip = ymfm::ym3812; //OPL2
@@ -191,20 +271,116 @@ private:
 
     OplInterface mInterface;
 
-    SDL_AudioStream* mStream = nullptr;
-
-
+    // chips 1..N-1 (setChipCount): melodic voices behind the song channels.
+    // They render next to chip 0 (worker threads) and are mixed into its
+    // samples before the filter, so every render mode applies to them.
+    static constexpr uint8_t JOB_DONE = 0;
+    static constexpr uint8_t JOB_QUEUED = 1;
+    static constexpr uint8_t JOB_RUNNING = 2;
+    struct ExtraChip {
+        OplInterface iface;
+        std::unique_ptr<OplChip> chip;
+        std::unique_ptr<OplChip::output_data[]> buffer; // OPL_CHIP_CHUNK_SAMPLES
+        uint8_t shadow[512] = {};
+        std::bitset<512> known;
+        uint8_t instruments[FMS_OPL3_CHANNELS][24] = {};
+        std::thread worker;
+        // JOB_QUEUED: nobody took the chunk yet, the first to swap it to
+        // JOB_RUNNING (its worker or the render thread) generates it
+        std::atomic<uint8_t> job = JOB_DONE;
+    };
+    std::vector<std::unique_ptr<ExtraChip>> mExtraChips;
+    OplVoiceAllocator mVoices;
+    OplPostProcess::MixFn mMixChips = OplPostProcess::mixSaturateScalar;
+
+    // live play (playLiveNote): the pool belongs to mLiveChannel and is
+    // rebuilt when the channel, an instrument (mInstrumentRevision) or the
+    // song state changes. mLiveClaims are the extra chip voices it holds.
+    OplLiveVoices mLive;
+    int mLiveChannel = -1;
+    bool mLiveSongPlaying = false;
+    uint32_t mInstrumentRevision = 0;
+    uint32_t mLiveRevision = 0;
+    uint16_t mLiveClaims[OplLiveVoices::MAX_VOICES] = {};
+    uint32_t mLiveClaimCount = 0;
+    uint32_t mLivePolyphony = 8;
+    void buildLivePool(int channel);
+    void dropLivePool();
+
+    // parallel render: a new ticket wakes the workers, each claims the
+    // queued job of its chip and generates mWorkSamples. The render thread
+    // takes the chips no worker has started when chip 0 is done.
+    bool mParallelChips = true;
+    uint32_t mWorkSamples = 0;
+    std::atomic<uint32_t> mWorkTicket = 0;
+    std::atomic<bool> mWorkStop = false;
+    // chips the render thread generated itself because the worker was late
+    std::atomic<uint64_t> mChipsTakenOver = 0;
+
+    static bool claimChip(ExtraChip& extra);
+    void chipWorker(ExtraChip* extra, uint32_t ticket);
+    void startWorkers();
+    void stopWorkers();
+    // chip 0 into mChipBuffer + 2, the extra chips mixed into it
+    void generateChips(uint32_t samples);
+
+    // live output (device), nullptr for offline controllers
+    std::unique_ptr<OplAudioOutput> mAudioOutput;
+
+    // pullOutput renders into this scratch block, allocated by applyOutputSpec
+    // and grown to the device buffer in initController, never on the audio thread
+    OplRenderBlock mRenderBlock;
+    // timing of every pullOutput call, written by the audio thread
+    OplRenderStats mRenderStats;
+
+    // GUI => render thread, drained by fillBuffer (see OplCommandQueue.h)
+    OplCommandQueue mCommands;
+    std::atomic<uint32_t> mCommandEpoch = 0;
+    std::atomic<uint32_t> mCommandsDropped = 0;
+
+    // render clock: frames rendered so far (render thread only) and
+    // the published start of the last block for timestamping commands
+    uint64_t mRenderFrame = 0;
+    std::atomic<uint64_t> mBlockStartFrame = 0;
+    std::atomic<uint32_t> mBlockFrames = 0;
+    std::atomic<int64_t>  mBlockStartNs = 0;
+
+    // true when the calling thread may touch the chip directly
+    bool isChipOwner() const;
+    // queue the command when we are not the chip owner, returns true if queued
+    bool deferCommand(OplCommand cmd);
+    uint64_t commandTimestamp() const;
+    void drainCommands(uint64_t frame);
+    void applyCommand(const OplCommand& cmd);
+    void applyInstrument(uint8_t channel, const uint8_t lIns[24]);
 
 
 
     // OPL RATIO
     double m_pos = 0.0;
-    double m_step = 49716.0 / 44100.0; // Ratio of OPL rate to SDL rate
+    double m_step = 49716.0 / 44100.0; // Ratio of OPL rate to output rate, see applyOutputSpec
+    OplOutputSpec mOutputSpec;
+    OplOutputSpec mExportSpec;   // see setExportSpec
+    OplOutputSpec::Format mFillFormat = OplOutputSpec::Format::S16; // format of the running fillBuffer
     OplChip::output_data mOutput;
-
-    // 9 channels, each holding 24 instrument parameters
-    uint8_t m_instrument_cache[9][24];
-    uint8_t m_instrument_name_cache[9][256]; //dos style string first byte is the len!
+    // block renderer buffers, see renderRun
+    // mChipBuffer: [0] previous sample, [1] current sample, [2..] bulk generate
+    OplChip::output_data* mChipBuffer = nullptr;
+    uint32_t mResampleIndex[OPL_RENDER_CHUNK_FRAMES]; // current sample in mChipBuffer per frame
+    // interleaved stereo input of the post process kernel
+    double mBlendFrac[OPL_RENDER_CHUNK_FRAMES * 2];   // blend weight of the previous sample, double like the old fillBuffer
+    float mBlendPrev[OPL_RENDER_CHUNK_FRAMES * 2];
+    float mBlendCur[OPL_RENDER_CHUNK_FRAMES * 2];
+    OplPostProcess::Kernel mPostProcessKernel = OplPostProcess::Kernel::Scalar;
+    OplPostProcess::BlendGainFn mBlendGain = OplPostProcess::blendGainScalar;
+    OplPostProcess::GainFn mGain = OplPostProcess::gainScalar;   // raw and sinc
+    // RenderMode::SINC, reset by the render thread when the mode is entered
+    OplSincResampler mSinc;
+    bool mSincActive = false;
+
+    // 9 channels (18 in OPL3 mode), each holding 24 instrument parameters
+    uint8_t m_instrument_cache[FMS_OPL3_CHANNELS][24];
+    uint8_t m_instrument_name_cache[FMS_OPL3_CHANNELS][256]; //dos style string first byte is the len!
 
 
     // F-Numbers for the Chromatic Scale (C, C#, D, D#, E, F, F#, G, G#, A, A#, B)
@@ -214,6 +390,9 @@ private:
     };
 
     // Tonleiter: {FNum_Hi_KeyOn, FNum_Low}
+    // f_numbers and myDosScale are the reference of OplNoteTable (the
+    // standard tuning reproduces them, see the static_assert in the .cpp),
+    // the notes play from mDosNotes / mChromaticNotes
 
     static constexpr uint8_t myDosScale[85][2] = {
         {0x00, 0x00}, // [0] Padding for 1-based indexing
@@ -260,6 +439,10 @@ private:
     // Mapping for OPL2 Operator offsets (Channels 0-8)
      const uint8_t Adr_add[9] = { 0x00, 0x01, 0x02, 0x08, 0x09, 0x0A, 0x10, 0x11, 0x12 };
 
+    // channel 0..17 of a chip: bank 1 (channels 9..17) is at 0x100
+    static uint16_t channelReg(uint8_t channel) { return (channel / 9) * 0x100 + channel % 9; }
+    uint16_t modulatorReg(uint8_t channel) const { return (channel / 9) * 0x100 + Adr_add[channel % 9]; }
+
 
     // Base OPL2 Register addresses for operators
      // Index 3-7 correspond to the OPL register groups
@@ -285,15 +468,43 @@ private:
     // this is updated
     bool mMelodicMode = true; // else RhythmMode
 
+    // note -> A0 / B0 of the current tuning (setTuning)
+    OplTuning mTuning;
+    OplNoteTable::DosTable mDosNotes = OplNoteTable::DOS_STANDARD;
+    OplNoteTable::ChromaticTable mChromaticNotes = OplNoteTable::CHROMATIC_STANDARD;
+
+    // OPL3 mode: NEW bit (0x105) set on every chip, 18 channels per chip,
+    // 4-op pairs on chip 0 (0x104)
+    bool mOpl3Mode = false;
+    uint8_t mFourOpMask = 0;
+    void applyOpl3Registers(uint8_t chip);
+
     uint8_t mShadowRegs[512] = {0}; //2026-01-11
+    // registers whose shadow matches the chip, cleared when the chip resets
+    std::bitset<512> mShadowKnown;
+    // write drops values the chip already has (see write)
+    bool mRegisterCoalescing = true;
+    std::atomic<uint64_t> mRegWritesIssued = 0;
+    std::atomic<uint64_t> mRegWritesElided = 0;
 
 public:
     OplController();
     ~OplController();
-    static void SDLCALL audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+    // the backend initController opens, the engine itself has no audio API
+    void setAudioOutput(std::unique_ptr<OplAudioOutput> output);
+    OplAudioOutput* getAudioOutput() { return mAudioOutput.get(); }
+    // true while an output pulls from this controller
+    bool isLive() const { return mAudioOutput && mAudioOutput->isOpen(); }
+    // negotiates rate and format with the device of the audio output
     bool initController();
+    bool initController(const OplOutputSpec& spec);
     bool shutDownController();
 
+    // called by the output backend on its audio thread: renders frames in
+    // the output spec and hands them to sink in one or more pieces
+    using OutputSink = void (*)(void* userdata, const void* data, uint32_t bytes);
+    void pullOutput(uint32_t frames, OutputSink sink, void* userdata);
+
 
 
     // need a lot of cleaning .. lol but for now it's here:
@@ -301,18 +512,34 @@ public:
     void togglePause();
 
 
-    SDL_AudioStream* getAudioStream() { return mStream; }
+    const OplOutputSpec& getOutputSpec() const { return mOutputSpec; }
+    // format of the wav export (cloneOffline), independent of the device.
+    // Default 44100 Hz S16, what most tools expect.
+    bool setExportSpec(const OplOutputSpec& spec);
+    const OplOutputSpec& getExportSpec() const { return mExportSpec; }
+    // for offline controllers, a live output keeps the spec of initController
+    bool setOutputSpec(const OplOutputSpec& spec);
+    // frames rendered by fillBuffer since the controller was created
+    uint64_t getRenderedFrames() const { return mRenderFrame; }
+    // heap allocations on the audio threads of the process, see
+    // OplAudioAllocations.h (0 unless the program counts them)
+    static uint64_t getAudioThreadAllocations() { return OplAudioAllocations::getCount(); }
+    static bool isCountingAudioThreadAllocations() { return OplAudioAllocations::isCounting(); }
+    uint32_t getCommandQueueDepth() const { return mCommands.size(); }
+    uint32_t getCommandsDropped() const { return mCommandsDropped.load(std::memory_order_relaxed); }
+    OplRenderStats::Snapshot getRenderStats() const { return mRenderStats.snapshot(); }
+    // register writes that reached the chip / were dropped as redundant
+    uint64_t getRegWritesIssued() const { return mRegWritesIssued.load(std::memory_order_relaxed); }
+    uint64_t getRegWritesElided() const { return mRegWritesElided.load(std::memory_order_relaxed); }
+    bool getRegisterCoalescing() const { return mRegisterCoalescing; }
+    void setRegisterCoalescing(bool value) { mRegisterCoalescing = value; }
+    void resetRenderStats() { mRenderStats.reset(); }
+    OplPostProcess::Kernel getPostProcessKernel() const { return mPostProcessKernel; }
     float getVolume() {
-        if (mStream) {
-            float gain = SDL_GetAudioStreamGain(mStream);
-            return (gain < 0.0f) ? 0.0f : gain;
-        }
-        return 0.f;
+        return isLive() ? mAudioOutput->getVolume() : 0.f;
     }
     bool setVolume(const float value) {
-        if (mStream)
-            return SDL_SetAudioStreamGain(mStream, value);
-        return false;
+        return isLive() && mAudioOutput->setVolume(value);
     }
 
 
@@ -326,16 +553,15 @@ public:
     }
 
     void setupToMelodicMode() {
-        // Read current state to preserve AM/Vibrato depth (Bits 6-7)
-        uint8_t currentBD = readShadow(0xBD);
-
-        // Clear Bit 5 (0x20) to disable Rhythm Mode
-        write(0xBD, currentBD & ~0x20);
+        // Clear Bit 5 (0x20) to disable Rhythm Mode, keeps the
+        // AM/Vibrato depth (Bits 6-7)
+        writeRhythm(0x20, 0);
     }
     void setupRhythmMode()
     {
-        // 1. Enable OPL3 extensions (Bank 1 access)
-        write(0x105, 0x01);
+        // 1. Bank 1 access (NEW, 0x105) belongs to setOpl3Mode. The write
+        //    here never reached the chip (the bank bit was dropped) and
+        //    would mute the melodic channels without their C0 panning.
 
         // 2. Set Panning and Connection (Center Pan, FM mode)
         // Do this BEFORE enabling rhythm to prevent a "pop" in the speakers
@@ -379,10 +605,80 @@ public:
     void silenceAll(bool hardStop);
     void set_speed(uint8_t songspeed);
     void reset();
-    void write(uint16_t reg, uint8_t val);
+    void write(uint16_t reg, uint8_t val) { writeChip(0, reg, val); }
+    void writeChip(uint8_t chip, uint16_t reg, uint8_t val);
+    // read modify write of 0xBD (rhythm mode, drum triggers, AM / vibrato
+    // depth) on the thread rendering the chip, clearMask before setMask
+    void writeRhythm(uint8_t clearMask, uint8_t setMask);
     uint8_t readShadow(uint16_t reg) {
         return mShadowRegs[reg];
     }
+    uint8_t readShadowChip(uint8_t chip, uint16_t reg) const {
+        if (chip == 0)
+            return mShadowRegs[reg];
+        return chip <= mExtraChips.size() ? mExtraChips[chip - 1]->shadow[reg] : 0;
+    }
+
+    // Multi chip: 1..OPL_MAX_CHIPS chips, the channel arguments of
+    // playNoteDOS, stopNote and setInstrument are logical channels
+    // (voices) chip * 9 + channel. Songs play on chip 0 (channels 0..8),
+    // the other chips are melodic only. Not for the audio thread, the
+    // chips are allocated here; all claims are dropped.
+    bool setChipCount(uint32_t chips);
+    uint32_t getChipCount() const { return 1 + (uint32_t)mExtraChips.size(); }
+    uint32_t getChipChannels() const { return mOpl3Mode ? FMS_OPL3_CHANNELS : OPL_CHIP_CHANNELS; }
+    uint32_t getVoiceCount() const { return getChipCount() * getChipChannels(); }
+    // a free voice behind the song channels, -1 if none (see OplVoiceAllocator)
+    int claimVoice() { return mVoices.claim(); }
+    bool releaseVoice(int voice) { return mVoices.release(voice); }
+    const OplVoiceAllocator& getVoices() const { return mVoices; }
+
+    // Live play (keyboard, piano): polyphonic over the voices which share
+    // the instrument of channel (chip 0). The pool is the channel itself,
+    // the song channels with the same instrument while no song plays and
+    // up to getLivePolyphony voices of the extra chips. A busy pool steals
+    // the voice released longest ago, else the oldest note (OplLiveVoices).
+    // Returns the voice which plays the note, -1 for none.
+    int playLiveNote(int channel, int noteIndex);
+    void stopLiveNote(int channel, int noteIndex);
+    void stopLiveNotes();
+    const OplLiveVoices& getLiveVoices() const { return mLive; }
+    uint32_t getLivePolyphony() const { return mLivePolyphony; }
+    void setLivePolyphony(uint32_t voices);
+    // OPL3 mode: both register banks, 18 channels per chip, the voices
+    // are renumbered and all claims dropped. Not for the audio thread.
+    void setOpl3Mode(bool value);
+    bool getOpl3Mode() const { return mOpl3Mode; }
+    // 4-op pairs of chip 0 (bits of 0x104): bit 0..2 channel 0..2 with
+    // 3..5, bit 3..5 channel 9..11 with 12..14. OPL3 mode only.
+    bool setFourOpMask(uint8_t mask);
+    uint8_t getFourOpMask() const { return mFourOpMask; }
+    // register 0x104 bit of the pair channel (0..17) belongs to, -1 for none
+    static constexpr int getFourOpBit(int channel)
+    {
+        return (channel < 0 || channel > FMS_OPL3_MAX_CHANNEL || channel % 9 > 5) ? -1 : (channel / 9) * 3 + channel % 3;
+    }
+    // the second channel of an active pair: its notes are ignored, its
+    // instrument is operator 3 / 4 of the pair
+    bool isFourOpSecondary(int channel) const
+    {
+        const int bit = getFourOpBit(channel);
+        return mOpl3Mode && bit >= 0 && channel % 9 >= 3 && (mFourOpMask & (1 << bit));
+    }
+
+    // render the extra chips on worker threads (default with more than one
+    // core) or one after another
+    bool getParallelChips() const { return mParallelChips; }
+    void setParallelChips(bool value) { mParallelChips = value; }
+    // chunks of the extra chips rendered on the audio thread because their
+    // worker had not started when chip 0 was done
+    uint64_t getChipsTakenOver() const { return mChipsTakenOver.load(std::memory_order_relaxed); }
+
+    // tuning of all notes (OplNoteTable::STANDARD, A432, STRETCHED or your
+    // own), playing notes keep their pitch until the next note on
+    void setTuning(const OplTuning& tuning);
+    const OplTuning& getTuning() const { return mTuning; }
+    const OplNoteTable::DosTable& getDosNotes() const { return mDosNotes; }
 
     void playDrum(int channel, int noteIndex);
 
@@ -398,7 +694,7 @@ public:
     // Helper to get the Pascal string for C++ string (0..8 -> 1..9)
     std::string getInstrumentNameFromCache(int channel)
     {
-        if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+        if (channel < FMS_MIN_CHANNEL || channel > FMS_OPL3_MAX_CHANNEL)
             return "";
         uint8_t len = m_instrument_name_cache[channel][0];
 
@@ -417,7 +713,7 @@ public:
 
     // Helper to set a Pascal string from a C-string (0..8 -> 1..9)
     bool setInstrumentNameInCache(int channel, const char* name) {
-        if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+        if (channel < FMS_MIN_CHANNEL || channel > FMS_OPL3_MAX_CHANNEL)
             return false;
 
         name = extractFilename(name).data();
@@ -434,38 +730,99 @@ public:
     bool loadSongFMS(const std::string& filename, SongDataFMS& sd);
     bool saveSongFMS(const std::string& filename,  SongDataFMS& sd);
 
+    // .fms layout: 9 x (name[256], instrument[24]), delay (byte),
+    // song_length (word), song_length x 9 notes (int16), little endian
+    static constexpr size_t FMS_HEADER_BYTES = 9 * (256 + 24) + 1 + 2;
+    // decodes a whole .fms image, sd is only touched if it is valid.
+    // Errors are logged with the byte offset, name is used in the messages.
+    static bool decodeSongFMS(const uint8_t* data, size_t size, SongDataFMS& sd, const char* name = "song");
+    static void encodeSongFMS(const SongDataFMS& sd, std::vector<uint8_t>& out);
+
+    // .fm3 (OPL3 song): "FM3" 0x1A, version, four_op, then the .fms layout
+    // with 18 channels. loadSongFMS detects it, saveSongFMS writes it in
+    // OPL3 mode.
+    static constexpr uint8_t FM3_MAGIC[4] = { 'F', 'M', '3', 0x1A };
+    static constexpr uint8_t FM3_VERSION = 1;
+    static constexpr size_t FM3_HEADER_BYTES = 6 + FMS_OPL3_CHANNELS * (256 + 24) + 1 + 2;
+    static bool isSongFM3(const uint8_t* data, size_t size)
+    {
+        return size >= 4 && std::memcmp(data, FM3_MAGIC, 4) == 0;
+    }
+    static bool decodeSongFM3(const uint8_t* data, size_t size, SongDataFMS& sd, const char* name = "song");
+    static void encodeSongFM3(const SongDataFMS& sd, std::vector<uint8_t>& out);
+
     std::string GetInstrumentName(SongDataFMS& sd, int channel);
     bool SetInstrumentName(SongDataFMS& sd,int channel, const char* name);
 
 
     // alias for start_song
-    void playSong(SongDataFMS& sd, bool loopit, int startAt=0, int stopAt=-1)
+    void playSong(const SongDataFMS& sd, bool loopit, int startAt=0, int stopAt=-1)
     {
         start_song(sd,loopit, startAt, stopAt);
     }
+    void playSong(SongSnapshot song, bool loopit, int startAt=0, int stopAt=-1)
+    {
+        start_song(std::move(song), loopit, startAt, stopAt);
+    }
     // stopAt=-1 means ==
-    void start_song(SongDataFMS& sd, bool loopit, int startAt=0, int stopAt=-1);
+    // plays a snapshot of sd, later edits of sd need publishSong
+    void start_song(const SongDataFMS& sd, bool loopit, int startAt=0, int stopAt=-1)
+    {
+        start_song(makeSnapshot(sd), loopit, startAt, stopAt);
+    }
+    void start_song(SongSnapshot song, bool loopit, int startAt=0, int stopAt=-1);
+    // replaces the playing song with an edited version, the position is
+    // kept. Lock free, the audio thread switches at its next block.
+    void publishSong(SongSnapshot song);
 
     bool loadInstrument(const std::string& filename, uint8_t channel);
     bool saveInstrument(const std::string& filename, uint8_t channel);
+    // .fm4: 4-op instrument, two .fmi images (operator 1 / 2, then 3 / 4)
+    // for the first channel of a 4-op pair, the pair is switched on
+    bool loadInstrument4Op(const std::string& filename, uint8_t channel);
+    bool saveInstrument4Op(const std::string& filename, uint8_t channel);
 
     void replaceSongNotes(SongDataFMS& sd, uint8_t targetChannel, int16_t oldNote, int16_t newNote);
 
+    // renders total_frames, GUI commands and sequencer ticks are applied
+    // at their exact frame, the chip is rendered in runs between them
+    // the buffer format must match the output spec: int16 for S16, float for F32
     void fillBuffer(int16_t* buffer, int total_frames);
+    void fillBuffer(float* buffer, int total_frames);
     void applyFilter();
+private:
+    // sets the rate dependent state (m_step, sinc table, samples_per_tick)
+    // NOT for the audio thread, the sinc table is rebuilt
+    void applyOutputSpec(const OplOutputSpec& spec);
+    void fillBlock(uint8_t* buffer, OplOutputSpec::Format format, int total_frames);
+    // renders frames [first, first + count) of the current block without events
+    void renderRun(uint8_t* buffer, int first, int count);
+    void renderRunSinc(uint8_t* buffer, int first, int count);
+    // passes of renderRun
+    uint32_t scheduleChunk(int first, int end, int& frames);
+    void filterChunk(OplChip::output_data* samples, uint32_t count);
+    void resampleChunk(uint8_t* out, int frames);
+    // blend + gain from mBlendPrev / mBlendCur / mBlendFrac in mFillFormat
+    void postProcessChunk(uint8_t* out, int frames);
+public:
 
 
     virtual void tickSequencer();
 
     // can be called in mail loop to output the playing song to console
     void consoleSongOutput(bool useNumbers = false);
-    std::string getNoteNameFromId(int noteID);
-    int getIdFromNoteName(std::string name);
+    // "C-4" for a DOS note id, "..." / "===" for empty / note off. Static
+    // storage from OplNoteTable, no allocation (drawn per visible cell).
+    static const char* getNoteNameFromId(int noteID);
+    // 0 if name is no note, see OplNoteTable::parseName
+    static int getIdFromNoteName(std::string_view name);
 
     const char* GetChannelName(int index)
     {
-        static const char* melodic[] = { "Channel 1", "Channel 2", "Channel 3", "Channel 4", "Channel 5", "Channel 6", "Channel 7", "Channel 8", "Channel 9" };
-        static const char* rhythm[]  = { "Channel 1", "Channel 2", "Channel 3", "Channel 4", "Channel 5", "Channel 6", "Bass Drum", "Snare/HH", "Tom/Cym" };
+        static const char* melodic[] = { "Channel 1", "Channel 2", "Channel 3", "Channel 4", "Channel 5", "Channel 6", "Channel 7", "Channel 8", "Channel 9",
+                                         "Channel 10", "Channel 11", "Channel 12", "Channel 13", "Channel 14", "Channel 15", "Channel 16", "Channel 17", "Channel 18" };
+        static const char* rhythm[]  = { "Channel 1", "Channel 2", "Channel 3", "Channel 4", "Channel 5", "Channel 6", "Bass Drum", "Snare/HH", "Tom/Cym",
+                                         "Channel 10", "Channel 11", "Channel 12", "Channel 13", "Channel 14", "Channel 15", "Channel 16", "Channel 17", "Channel 18" };
 
         if (mMelodicMode)
             return melodic[index];
@@ -474,8 +831,10 @@ public:
     }
     const char* GetChannelNameShort(int index)
     {
-        static const char* melodic[] = { "CH#1", "CH#2", "CH#3", "CH#4", "CH#5", "CH#6", "CH#7", "CH#8", "CH#9" };
-        static const char* rhythm[]  = { "CH#1", "CH#2", "CH#3", "CH#4", "CH#5", "CH#6", "Bass Drum", "Snare/HH", "Tom/Cym" };
+        static const char* melodic[] = { "CH#1", "CH#2", "CH#3", "CH#4", "CH#5", "CH#6", "CH#7", "CH#8", "CH#9",
+                                         "CH#10", "CH#11", "CH#12", "CH#13", "CH#14", "CH#15", "CH#16", "CH#17", "CH#18" };
+        static const char* rhythm[]  = { "CH#1", "CH#2", "CH#3", "CH#4", "CH#5", "CH#6", "Bass Drum", "Snare/HH", "Tom/Cym",
+                                         "CH#10", "CH#11", "CH#12", "CH#13", "CH#14", "CH#15", "CH#16", "CH#17", "CH#18" };
 
         if (mMelodicMode)
             return melodic[index];
@@ -507,10 +866,29 @@ public:
     void resetInstrument(uint8_t channel);
     void loadInstrumentPreset();
     void loadInstrumentPresetSyncSongName(SongDataFMS& sd);
-    bool exportToWav(SongDataFMS &sd, const std::string& filename, float* progressOut = nullptr);
+    // renders the song on a private copy (cloneOffline), the live
+    // controller keeps playing
+    bool exportToWav(const SongDataFMS &sd, const std::string& filename, std::atomic<float>* progressOut = nullptr);
+
+    // Offline copy of the sound state (registers, instruments, render mode)
+    // with its own chip and sequencer, no audio stream. It renders in the
+    // export spec (setExportSpec).
+    // Call it from the thread which changes the instruments (GUI), the copy
+    // may then render on any thread.
+    virtual std::unique_ptr<OplController> cloneOffline() const;
+    // renders sd from the start into a wav file, this must not be the live
+    // controller (see cloneOffline). progressOut (0..1) may be polled by
+    // other threads while the render runs.
+    bool renderToWav(const SongDataFMS& sd, const std::string& filename, std::atomic<float>* progressOut = nullptr)
+    {
+        return renderToWav(makeSnapshot(sd), filename, progressOut);
+    }
+    bool renderToWav(SongSnapshot song, const std::string& filename, std::atomic<float>* progressOut = nullptr);
+
+protected:
+    void copySoundState(const OplController& source);
+public:
 
-private:
-    bool saveWavFile(const std::string& filename, const std::vector<int16_t>& data, int sampleRate);
 
 
 }; //class
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Polyphonic live play (keyboard, piano widgets): a pool of voices which
+// share one instrument. A note goes to a free voice, a note already held
+// retriggers its voice. With all voices busy one is stolen:
+//   1. the voice released longest ago: the quietest, its release phase
+//      decayed the most (all voices play the same instrument)
+//   2. else the voice held longest (oldest note)
+//
+// The voices sit in two intrusive lists (released, held) in the order of
+// their last note on / off, so the age of a voice is its place in a list:
+// note on, note off and the steal are O(1).
+// Not thread safe, use it from the thread which plays the notes (GUI).
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+class OplLiveVoices
+{
+public:
+    static constexpr uint32_t MAX_VOICES = 32;
+    static constexpr int MAX_NOTE = 128;
+
+    struct NoteOn {
+        int voice = -1;      // plays the note, -1 without a pool
+        int stolenNote = 0;  // note the voice was holding, 0 for none
+    };
+
+private:
+    struct Slot {
+        uint16_t voice = 0;
+        int16_t note = 0;   // held note, 0 when released
+        int8_t prev = -1;
+        int8_t next = -1;
+    };
+    struct List {
+        int8_t head = -1;   // oldest
+        int8_t tail = -1;   // newest
+    };
+
+    Slot mSlots[MAX_VOICES];
+    uint32_t mCount = 0;
+    List mReleased;
+    List mHeld;
+    int8_t mSlotOfNote[MAX_NOTE];
+
+    void unlink(List& list, int slot)
+    {
+        Slot& s = mSlots[slot];
+        if (s.prev >= 0) mSlots[s.prev].next = s.next; else list.head = s.next;
+        if (s.next >= 0) mSlots[s.next].prev = s.prev; else list.tail = s.prev;
+        s.prev = s.next = -1;
+    }
+    void append(List& list, int slot)
+    {
+        Slot& s = mSlots[slot];
+        s.prev = list.tail;
+        s.next = -1;
+        if (list.tail >= 0) mSlots[list.tail].next = (int8_t)slot; else list.head = (int8_t)slot;
+        list.tail = (int8_t)slot;
+    }
+
+public:
+    OplLiveVoices() { setPool(nullptr, 0); }
+
+    // the voices of the pool, the first one is used first. Drops all notes.
+    void setPool(const uint16_t* voices, uint32_t count)
+    {
+        mCount = count > MAX_VOICES ? MAX_VOICES : count;
+        mReleased = List();
+        mHeld = List();
+        std::memset(mSlotOfNote, -1, sizeof(mSlotOfNote));
+        for (uint32_t i = 0; i < mCount; i++) {
+            mSlots[i] = Slot();
+            mSlots[i].voice = voices[i];
+            append(mReleased, (int)i);
+        }
+    }
+
+    NoteOn noteOn(int note)
+    {
+        NoteOn result;
+        if (mCount == 0 || note <= 0 || note >= MAX_NOTE)
+            return result;
+
+        int slot = mSlotOfNote[note];
+        if (slot >= 0) {
+            unlink(mHeld, slot);          // retrigger, it becomes the newest
+        } else if (mReleased.head >= 0) {
+            slot = mReleased.head;
+            unlink(mReleased, slot);
+        } else {
+            slot = mHeld.head;
+            unlink(mHeld, slot);
+            result.stolenNote = mSlots[slot].note;
+            mSlotOfNote[result.stolenNote] = -1;
+        }
+        mSlots[slot].note = (int16_t)note;
+        mSlotOfNote[note] = (int8_t)slot;
+        append(mHeld, slot);
+        result.voice = mSlots[slot].voice;
+        return result;
+    }
+
+    // the voice which held note, -1 if none does
+    int noteOff(int note)
+    {
+        if (note <= 0 || note >= MAX_NOTE || mSlotOfNote[note] < 0)
+            return -1;
+        const int slot = mSlotOfNote[note];
+        mSlotOfNote[note] = -1;
+        mSlots[slot].note = 0;
+        unlink(mHeld, slot);
+        append(mReleased, slot);
+        return mSlots[slot].voice;
+    }
+
+    // the voice of the oldest held note, -1 if none is held
+    int getOldestHeldVoice() const { return mHeld.head >= 0 ? mSlots[mHeld.head].voice : -1; }
+    int getOldestHeldNote() const { return mHeld.head >= 0 ? mSlots[mHeld.head].note : 0; }
+
+    uint32_t getPoolSize() const { return mCount; }
+    int getVoice(uint32_t slot) const { return slot < mCount ? mSlots[slot].voice : -1; }
+    bool isHeld(int note) const { return note > 0 && note < MAX_NOTE && mSlotOfNote[note] >= 0; }
+};
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Logging for lib/opl: the OhmFlux errorlog in the editor, a minimal stderr
+// logger when built standalone (OPL_STANDALONE, e.g. fmsrender).
+// stdout is left alone, fmsrender writes raw PCM to it.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#ifndef OPL_STANDALONE
+
+#include "errorlog.h"
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+inline bool gOplLogQuiet = false; // fmsrender --quiet
+
+inline void Log(const char* fmt, ...)
+{
+    if (gOplLogQuiet)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+}
+
+inline void dLog(const char* fmt, ...)
+{
+#ifdef _DEBUG
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+#else
+    (void)fmt;
+#endif
+}
+
+// "{}" placeholders are replaced in order, no format specs
+template <typename... Args>
+inline void LogFMT(const std::string& fmt, const Args&... args)
+{
+    if (gOplLogQuiet)
+        return;
+    std::ostringstream out;
+    size_t pos = 0;
+    auto put = [&](const auto& value) {
+        size_t next = fmt.find("{}", pos);
+        if (next == std::string::npos)
+            return;
+        out << fmt.substr(pos, next - pos) << value;
+        pos = next + 2;
+    };
+    (put(args), ...);
+    out << fmt.substr(pos);
+    std::fprintf(stderr, "%s\n", out.str().c_str());
+}
+
+#endif // OPL_STANDALONE
@@ -0,0 +1,190 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Note -> final 0xA0 / 0xB0 register bytes, generated at compile time from
+// a tuning (reference pitch, detune, stretch), so a note on is two table
+// loads and two register writes.
+//
+// F-number = frequency * 2^(20 - block) / clock. The DOS tables were made
+// with a 50 kHz clock (the chip runs at 49716 Hz), OplTuning keeps that
+// as default: the standard table is byte for byte myDosScale.
+//
+// Two layouts:
+// * DOS note ids 1..84 (songs, playNoteDOS, playDrum): row r = (id-1) / 12
+//   plays in block r, D E F G A B C# D# F# G# A# C(+1). Id 0 is padding.
+// * chromatic ids octave * 12 + semitone, C = 0 (playNote), block = octave
+//
+// The note names of the DOS ids ("D-1" .. "C-8", "..." for id 0) are a
+// static table as well, name -> id is a switch on the letters, neither
+// allocates.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct OplTuning {
+    double referenceHz = 440.0;  // A4 (A in block 4, DOS id 53)
+    double detuneCents = 0.0;    // the whole table
+    double stretchCents = 0.0;   // per octave away from A4, > 0 widens the octaves like a piano
+    double clockHz = 50000.0;    // F-number clock, see above
+};
+
+struct OplNoteRegs {
+    uint8_t a0;  // F-number low
+    uint8_t b0;  // key on | block << 2 | F-number high
+};
+
+namespace OplNoteTable {
+
+    constexpr int DOS_NOTES = 85;
+    constexpr int CHROMATIC_NOTES = 96;
+    using DosTable = std::array<OplNoteRegs, DOS_NOTES>;
+    using ChromaticTable = std::array<OplNoteRegs, CHROMATIC_NOTES>;
+
+    // semitone above C of the block for each position of a DOS row
+    constexpr int DOS_ROW_SEMITONES[12] = { 2, 4, 5, 7, 9, 11, 1, 3, 6, 8, 10, 12 };
+
+    // 2^x without <cmath>, which is not constexpr: Taylor series of e^y on
+    // the fraction, exact to double precision for the range we need
+    constexpr double exp2(double x)
+    {
+        int whole = (int)x;
+        if (x < whole)
+            whole--;
+        const double y = (x - whole) * 0.69314718055994530942;
+        double term = 1.0, sum = 1.0;
+        for (int k = 1; k < 24; k++) {
+            term *= y / k;
+            sum += term;
+        }
+        for (; whole > 0; whole--) sum *= 2.0;
+        for (; whole < 0; whole++) sum *= 0.5;
+        return sum;
+    }
+
+    // semitone: above C of block, may reach into the next octave
+    constexpr OplNoteRegs makeRegs(int block, int semitone, const OplTuning& tuning)
+    {
+        const double fromA4 = (block - 4) * 12 + semitone - 9;
+        const double cents = fromA4 * 100.0 + tuning.detuneCents + tuning.stretchCents * fromA4 / 12.0;
+        const double hz = tuning.referenceHz * exp2(cents / 1200.0);
+
+        int fnum = (int)(hz * exp2(20 - block) / tuning.clockHz + 0.5);
+        // a detuned note may leave the F-number range of its block
+        while (fnum > 0x3FF && block < 7) {
+            fnum = (fnum + 1) / 2;
+            block++;
+        }
+        while (fnum < 0x100 && block > 0) {
+            fnum *= 2;
+            block--;
+        }
+        fnum = fnum > 0x3FF ? 0x3FF : (fnum < 0 ? 0 : fnum);
+        return { (uint8_t)(fnum & 0xFF), (uint8_t)(0x20 | (block << 2) | (fnum >> 8)) };
+    }
+
+    constexpr DosTable makeDos(const OplTuning& tuning)
+    {
+        DosTable table{};
+        for (int id = 1; id < DOS_NOTES; id++)
+            table[id] = makeRegs((id - 1) / 12, DOS_ROW_SEMITONES[(id - 1) % 12], tuning);
+        return table;
+    }
+
+    constexpr ChromaticTable makeChromatic(const OplTuning& tuning)
+    {
+        ChromaticTable table{};
+        for (int id = 0; id < CHROMATIC_NOTES; id++)
+            table[id] = makeRegs(id / 12, id % 12, tuning);
+        return table;
+    }
+
+    //--------------------------------------------------------------------------
+    // note names: "C-4", "C#4", a C closes a DOS row and belongs to the
+    // octave above it
+    constexpr int NAME_SIZE = 4;  // 3 characters + terminator
+    using NameTable = std::array<std::array<char, NAME_SIZE>, DOS_NOTES>;
+
+    constexpr char NAME_LETTERS[] = "CCDDEFFGGAAB";
+    constexpr char NAME_ACCIDENTALS[] = "-#-#--#-#-#-";
+
+    constexpr NameTable makeNames()
+    {
+        NameTable table{};
+        table[0] = { '.', '.', '.', 0 };
+        for (int id = 1; id < DOS_NOTES; id++) {
+            const int semitone = DOS_ROW_SEMITONES[(id - 1) % 12] % 12;
+            table[id] = { NAME_LETTERS[semitone], NAME_ACCIDENTALS[semitone], (char)('0' + id / 12 + 1), 0 };
+        }
+        return table;
+    }
+
+    inline constexpr NameTable NAMES = makeNames();
+
+    // id of a name, 0 for "...", -1 for "===" (note off), 0 for anything
+    // which is no note. Extra characters after the octave are ignored.
+    constexpr int parseName(const char* name, size_t length)
+    {
+        if (length < 3)
+            return 0;
+        if (name[0] == '=' && name[1] == '=' && name[2] == '=')
+            return -1;
+
+        int semitone;
+        switch (name[0]) {
+            case 'C': semitone = 0; break;
+            case 'D': semitone = 2; break;
+            case 'E': semitone = 4; break;
+            case 'F': semitone = 5; break;
+            case 'G': semitone = 7; break;
+            case 'A': semitone = 9; break;
+            case 'B': semitone = 11; break;
+            default: return 0;
+        }
+        switch (name[1]) {
+            case '-': break;
+            case '#':
+                if (semitone == 4 || semitone == 11)  // no E#, B#
+                    return 0;
+                semitone++;
+                break;
+            default: return 0;
+        }
+
+        int octave = 0;
+        size_t pos = 2;
+        for (; pos < length && name[pos] >= '0' && name[pos] <= '9' && octave < 100; pos++)
+            octave = octave * 10 + (name[pos] - '0');
+        if (pos == 2)
+            return 0;
+
+        // position of the semitone in a DOS row, the inverse of DOS_ROW_SEMITONES
+        constexpr int ROW_POSITION[12] = { 11, 6, 0, 7, 1, 2, 8, 3, 9, 4, 10, 5 };
+        const int row = semitone == 0 ? octave - 2 : octave - 1;
+        const int id = row * 12 + ROW_POSITION[semitone] + 1;
+        return (row >= 0 && id >= 1 && id < DOS_NOTES) ? id : 0;
+    }
+
+    constexpr bool namesRoundTrip()
+    {
+        for (int id = 0; id < DOS_NOTES; id++)
+            if (parseName(NAMES[id].data(), NAME_SIZE - 1) != id)
+                return false;
+        return true;
+    }
+    static_assert(namesRoundTrip(), "note names and parseName disagree");
+
+    //--------------------------------------------------------------------------
+    constexpr OplTuning STANDARD{};
+    constexpr OplTuning A432{ 432.0 };
+    constexpr OplTuning STRETCHED{ 440.0, 0.0, 3.0 };
+
+    inline constexpr DosTable DOS_STANDARD = makeDos(STANDARD);
+    inline constexpr DosTable DOS_A432 = makeDos(A432);
+    inline constexpr DosTable DOS_STRETCHED = makeDos(STRETCHED);
+    inline constexpr ChromaticTable CHROMATIC_STANDARD = makeChromatic(STANDARD);
+
+} // namespace OplNoteTable
@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Output spec of the controller: sample rate and sample format of the
+// interleaved stereo frames written by fillBuffer, the audio stream and
+// the wav export.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+
+struct OplOutputSpec {
+    enum class Format : uint8_t {
+        S16,  // int16, clamped
+        F32   // float -1..1, not clamped
+    };
+
+    static constexpr uint32_t CHANNELS = 2;
+    static constexpr int DEFAULT_RATE = 44100;
+    static constexpr int MIN_RATE = 8000;
+    static constexpr int MAX_RATE = 192000;
+
+    int rate = DEFAULT_RATE;
+    Format format = Format::S16;
+
+    static constexpr uint32_t frameBytes(Format format) {
+        return ((format == Format::F32) ? sizeof(float) : sizeof(int16_t)) * CHANNELS;
+    }
+
+    uint32_t bytesPerSample() const { return frameBytes(format) / CHANNELS; }
+    uint32_t bytesPerFrame() const { return frameBytes(format); }
+    bool isValid() const { return rate >= MIN_RATE && rate <= MAX_RATE; }
+
+    bool operator==(const OplOutputSpec& other) const { return rate == other.rate && format == other.format; }
+};
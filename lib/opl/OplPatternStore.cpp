@@ -0,0 +1,209 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplPatternStore.h"
+
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+static std::atomic<uint64_t> sNextRevision = 1;
+static std::atomic<uint64_t> sNextOwner = 1;
+
+//------------------------------------------------------------------------------
+void OplPatternStore::touch()
+{
+    mRevision = sNextRevision.fetch_add(1, std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+uint64_t OplPatternStore::newOwner()
+{
+    return sNextOwner.fetch_add(1, std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+OplPatternStore::OplPatternStore(const OplPatternStore& other)
+    : mOrder(other.mOrder), mRevision(other.mRevision), mOwner(newOwner())
+{
+    // the patterns are shared now, other has to copy them before a write too
+    other.mOwner.store(newOwner(), std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+OplPatternStore::OplPatternStore(OplPatternStore&& other) noexcept
+    : mOrder(std::move(other.mOrder)), mRevision(other.mRevision),
+      mOwner(other.mOwner.load(std::memory_order_relaxed))
+{
+    other.mOrder.clear();
+    other.mOwner.store(newOwner(), std::memory_order_relaxed);
+    other.touch();
+}
+//------------------------------------------------------------------------------
+OplPatternStore& OplPatternStore::operator=(const OplPatternStore& other)
+{
+    if (this != &other) {
+        mOrder = other.mOrder;
+        mRevision = other.mRevision;
+        mOwner.store(newOwner(), std::memory_order_relaxed);
+        other.mOwner.store(newOwner(), std::memory_order_relaxed);
+    }
+    return *this;
+}
+//------------------------------------------------------------------------------
+OplPatternStore& OplPatternStore::operator=(OplPatternStore&& other) noexcept
+{
+    if (this != &other) {
+        mOrder = std::move(other.mOrder);
+        mRevision = other.mRevision;
+        mOwner.store(other.mOwner.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.mOrder.clear();
+        other.mOwner.store(newOwner(), std::memory_order_relaxed);
+        other.touch();
+    }
+    return *this;
+}
+//------------------------------------------------------------------------------
+bool OplPatternStore::Pattern::isEmpty() const
+{
+    for (int16_t cell : cells)
+        if (cell != 0)
+            return false;
+    return true;
+}
+//------------------------------------------------------------------------------
+OplPatternStore::Pattern* OplPatternStore::writable(uint32_t row)
+{
+    const uint32_t index = row / PATTERN_ROWS;
+    if (index >= mOrder.size())
+        mOrder.resize(index + 1);
+
+    PatternPtr& pattern = mOrder[index];
+    const uint64_t owner = mOwner.load(std::memory_order_relaxed);
+    if (!pattern)
+        pattern = std::make_shared<Pattern>();
+    else if (pattern->owner != owner)
+        pattern = std::make_shared<Pattern>(*pattern);
+    else
+        return pattern.get();
+    pattern->owner = owner;
+    return pattern.get();
+}
+//------------------------------------------------------------------------------
+bool OplPatternStore::set(uint32_t row, uint32_t channel, int16_t value)
+{
+    if (row >= MAX_ROWS || channel >= CHANNELS)
+        return false;
+
+    // unchanged cells neither allocate nor unshare
+    if (get(row, channel) == value)
+        return true;
+
+    writable(row)->set(row % PATTERN_ROWS, channel, value);
+    touch();
+    return true;
+}
+//------------------------------------------------------------------------------
+bool OplPatternStore::importRows(const int16_t* grid, uint32_t rows, uint32_t columns)
+{
+    if (rows > MAX_ROWS || columns > CHANNELS)
+        return false;
+
+    clear();
+    mOrder.resize((rows + PATTERN_ROWS - 1) / PATTERN_ROWS);
+
+    // FNV-1a of the cells -> patterns already placed with that hash
+    std::unordered_map<uint64_t, std::vector<PatternPtr>> seen;
+    Pattern block;
+    for (uint32_t index = 0; index < mOrder.size(); index++) {
+        const uint32_t first = index * PATTERN_ROWS;
+        const uint32_t count = std::min(PATTERN_ROWS, rows - first);
+
+        block = Pattern();
+        for (uint32_t r = 0; r < count; r++)
+            for (uint32_t ch = 0; ch < columns; ch++)
+                block.set(r, ch, grid[(first + r) * columns + ch]);
+
+        if (block.isEmpty())
+            continue;
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (int16_t cell : block.cells) {
+            hash ^= (uint16_t)cell;
+            hash *= 0x100000001b3ull;
+        }
+
+        std::vector<PatternPtr>& candidates = seen[hash];
+        for (const PatternPtr& candidate : candidates) {
+            if (*candidate == block) {
+                mOrder[index] = candidate;
+                break;
+            }
+        }
+        if (!mOrder[index]) {
+            mOrder[index] = std::make_shared<Pattern>(block);
+            candidates.push_back(mOrder[index]);
+        }
+    }
+
+    // a pattern in one slot is ours, one in several slots stays shared
+    // (owner 0) and is copied by the first write
+    std::unordered_map<Pattern*, uint32_t> uses;
+    for (const PatternPtr& pattern : mOrder)
+        if (pattern)
+            uses[pattern.get()]++;
+    const uint64_t owner = mOwner.load(std::memory_order_relaxed);
+    for (const auto& [pattern, count] : uses)
+        if (count == 1)
+            pattern->owner = owner;
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplPatternStore::exportRows(int16_t* grid, uint32_t rows, uint32_t columns) const
+{
+    columns = std::min(columns, CHANNELS);
+    int16_t line[CHANNELS];
+    for (uint32_t row = 0; row < rows; row++) {
+        getRow(row, line);
+        std::memcpy(grid + row * columns, line, columns * sizeof(int16_t));
+    }
+}
+//------------------------------------------------------------------------------
+void OplPatternStore::diff(const OplPatternStore& before, std::vector<CellChange>& changes) const
+{
+    if (before.mRevision == mRevision)
+        return;
+
+    static const Pattern sEmpty;
+    const size_t slots = std::max(mOrder.size(), before.mOrder.size());
+    for (size_t index = 0; index < slots; index++) {
+        const Pattern* now = index < mOrder.size() ? mOrder[index].get() : nullptr;
+        const Pattern* old = index < before.mOrder.size() ? before.mOrder[index].get() : nullptr;
+        if (now == old)
+            continue;
+        if (!now) now = &sEmpty;
+        if (!old) old = &sEmpty;
+
+        // channel major like the cells, the changes come out sorted by channel
+        for (uint32_t ch = 0; ch < CHANNELS; ch++) {
+            for (uint32_t r = 0; r < PATTERN_ROWS; r++) {
+                const int16_t a = old->get(r, ch);
+                const int16_t b = now->get(r, ch);
+                if (a != b)
+                    changes.push_back({ (uint16_t)(index * PATTERN_ROWS + r), (uint8_t)ch, a, b });
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------
+uint32_t OplPatternStore::getPatternCount() const
+{
+    std::unordered_set<const Pattern*> distinct;
+    for (const PatternPtr& pattern : mOrder)
+        if (pattern)
+            distinct.insert(pattern.get());
+    return (uint32_t)distinct.size();
+}
+//------------------------------------------------------------------------------
+size_t OplPatternStore::getMemoryBytes() const
+{
+    return mOrder.capacity() * sizeof(PatternPtr) + getPatternCount() * sizeof(Pattern);
+}
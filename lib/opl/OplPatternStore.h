@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Note storage of a song: fixed size patterns of PATTERN_ROWS rows and an
+// order list which places them one after the other.
+//
+// * a pattern keeps each channel contiguous: cells[channel * ROWS + row]
+// * an empty order slot (nullptr) reads as 0 and costs nothing
+// * the same pattern may sit in several slots, a write unshares it first
+//   (copy on write), so copying a store only copies the order list
+// * a store writes in place only into patterns it owns: each store has an
+//   owner tag, a pattern keeps the tag of the store that made it. Copying
+//   a store gives both sides new tags, so neither writes into a pattern a
+//   snapshot on another thread still reads (no use_count guess)
+// * it grows on demand up to MAX_ROWS, reading past the end gives 0
+//
+// Every change takes a new revision from a global counter: two stores with
+// the same revision hold the same notes (one is a copy of the other).
+//
+// A pattern holds the 18 channels of an OPL3 song (.fm3), a .fms song uses
+// the first 9. The file grids ([row][channel], row major, 9 or 18 columns)
+// go through importRows / exportRows.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+class OplPatternStore
+{
+public:
+    static constexpr uint32_t CHANNELS = 18;      // both OPL3 register banks
+    static constexpr uint32_t PATTERN_ROWS = 64;
+    static constexpr uint32_t MAX_ROWS = 65536;   // song_length is a word
+    static constexpr uint32_t MAX_PATTERNS = MAX_ROWS / PATTERN_ROWS;
+
+    struct Pattern {
+        int16_t cells[CHANNELS * PATTERN_ROWS] = {};
+        uint64_t owner = 0; // tag of the store which may write in place, 0 = shared
+
+        int16_t get(uint32_t row, uint32_t channel) const { return cells[channel * PATTERN_ROWS + row]; }
+        void set(uint32_t row, uint32_t channel, int16_t value) { cells[channel * PATTERN_ROWS + row] = value; }
+        bool isEmpty() const;
+        bool operator==(const Pattern& other) const { return std::memcmp(cells, other.cells, sizeof(cells)) == 0; }
+    };
+
+    using PatternPtr = std::shared_ptr<Pattern>;
+
+    struct CellChange {
+        uint16_t row;
+        uint8_t channel;
+        int16_t before;
+        int16_t after;
+    };
+
+private:
+    std::vector<PatternPtr> mOrder;
+    uint64_t mRevision = 0;
+    // atomic: a copy retags its source, snapshots are copied from any thread
+    mutable std::atomic<uint64_t> mOwner;
+
+    void touch();
+    static uint64_t newOwner();
+
+    // slot of row, nullptr if not allocated (no growth)
+    const Pattern* slot(uint32_t row) const
+    {
+        const uint32_t index = row / PATTERN_ROWS;
+        return index < mOrder.size() ? mOrder[index].get() : nullptr;
+    }
+
+    // writable pattern of row: grows the order list, allocates empty slots
+    // and unshares a pattern this store does not own
+    Pattern* writable(uint32_t row);
+
+public:
+    OplPatternStore() : mOwner(newOwner()) {}
+    OplPatternStore(const OplPatternStore& other);
+    OplPatternStore(OplPatternStore&& other) noexcept;
+    OplPatternStore& operator=(const OplPatternStore& other);
+    OplPatternStore& operator=(OplPatternStore&& other) noexcept;
+
+    int16_t get(uint32_t row, uint32_t channel) const
+    {
+        if (channel >= CHANNELS)
+            return 0;
+        const Pattern* pattern = slot(row);
+        return pattern ? pattern->get(row % PATTERN_ROWS, channel) : 0;
+    }
+
+    // false if row or channel is out of range
+    bool set(uint32_t row, uint32_t channel, int16_t value);
+
+    // all channels of a row, for the sequencer
+    void getRow(uint32_t row, int16_t out[CHANNELS]) const
+    {
+        const Pattern* pattern = slot(row);
+        for (uint32_t ch = 0; ch < CHANNELS; ch++)
+            out[ch] = pattern ? pattern->get(row % PATTERN_ROWS, ch) : 0;
+    }
+
+    // drops every pattern, keeps the capacity of the order list
+    void clear() { mOrder.clear(); touch(); }
+
+    // reserves order slots for rows without allocating patterns
+    void reserveRows(uint32_t rows) { mOrder.reserve((std::min(rows, MAX_ROWS) + PATTERN_ROWS - 1) / PATTERN_ROWS); }
+
+    // rows covered by the order list
+    uint32_t capacityRows() const { return (uint32_t)mOrder.size() * PATTERN_ROWS; }
+
+    // file grid: rows * columns notes, row major, columns <= CHANNELS
+    // identical patterns share one allocation, empty ones none
+    bool importRows(const int16_t* grid, uint32_t rows, uint32_t columns);
+    void exportRows(int16_t* grid, uint32_t rows, uint32_t columns) const;
+
+    // appends the cells which differ from before. Only slots holding a
+    // different pattern are compared, so the cost follows the edit, not
+    // the song length.
+    void diff(const OplPatternStore& before, std::vector<CellChange>& changes) const;
+
+    uint64_t getRevision() const { return mRevision; }
+    const std::vector<PatternPtr>& getOrder() const { return mOrder; }
+    // distinct allocated patterns
+    uint32_t getPatternCount() const;
+    // bytes held by the order list and the distinct patterns
+    size_t getMemoryBytes() const;
+};
@@ -0,0 +1,480 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplPostProcess.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define OPL_PP_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define OPL_PP_TARGET_AVX2
+    #else
+        #define OPL_PP_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define OPL_PP_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace OplPostProcess {
+
+//------------------------------------------------------------------------------
+void blendGainScalar(const float* prev, const float* cur, const double* frac,
+                     float gain, int16_t* out, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++) {
+        double f = frac[i];
+        double v = (prev[i] * f + cur[i] * (1.0 - f)) * gain;
+        out[i] = static_cast<int16_t>(std::clamp(v, -32768.0, 32767.0));
+    }
+}
+
+//------------------------------------------------------------------------------
+void gainScalar(const float* in, float gain, int16_t* out, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++)
+        out[i] = static_cast<int16_t>(std::clamp(in[i] * gain, -32768.0f, 32767.0f));
+}
+
+//------------------------------------------------------------------------------
+void blendGainF32(const float* prev, const float* cur, const double* frac,
+                  float gain, float* out, uint32_t samples)
+{
+    const float scale = gain / 32768.0f;
+    for (uint32_t i = 0; i < samples; i++) {
+        const float f = static_cast<float>(frac[i]);
+        out[i] = (prev[i] * f + cur[i] * (1.0f - f)) * scale;
+    }
+}
+//------------------------------------------------------------------------------
+void gainF32(const float* in, float gain, float* out, uint32_t samples)
+{
+    const float scale = gain / 32768.0f;
+    for (uint32_t i = 0; i < samples; i++)
+        out[i] = in[i] * scale;
+}
+//------------------------------------------------------------------------------
+// float version with the operation order of the SIMD kernels, used for
+// their tails so the result does not depend on the block size
+[[maybe_unused]] static void blendGainTail(const float* prev, const float* cur, const double* frac,
+                                           float gain, int16_t* out, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++) {
+        const float f = static_cast<float>(frac[i]);
+        float v = (prev[i] * f + cur[i] * (1.0f - f)) * gain;
+        out[i] = static_cast<int16_t>(std::clamp(v, -32768.0f, 32767.0f));
+    }
+}
+
+//------------------------------------------------------------------------------
+void mixSaturateScalar(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                       uint32_t values)
+{
+    for (uint32_t i = 0; i < values; i++) {
+        int32_t v = dst[i];
+        for (uint32_t s = 0; s < sourceCount; s++)
+            v += sources[s][i];
+        dst[i] = std::clamp(v, -32768, 32767);
+    }
+}
+
+#ifdef OPL_PP_X86
+//------------------------------------------------------------------------------
+static void mixSaturateSSE2(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                            uint32_t values)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= values; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        for (uint32_t s = 0; s < sourceCount; s++)
+            v = _mm_add_epi32(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sources[s] + i)));
+        // no min / max epi32 in SSE2: saturate to int16 and sign extend back
+        __m128i packed = _mm_packs_epi32(v, v);
+        v = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    const int32_t* tails[MAX_MIX_SOURCES];
+    for (uint32_t s = 0; s < sourceCount; s++)
+        tails[s] = sources[s] + i;
+    mixSaturateScalar(dst + i, tails, sourceCount, values - i);
+}
+//------------------------------------------------------------------------------
+OPL_PP_TARGET_AVX2
+static void mixSaturateAVX2(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                            uint32_t values)
+{
+    const __m256i lo = _mm256_set1_epi32(-32768);
+    const __m256i hi = _mm256_set1_epi32(32767);
+
+    uint32_t i = 0;
+    for (; i + 8 <= values; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        for (uint32_t s = 0; s < sourceCount; s++)
+            v = _mm256_add_epi32(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sources[s] + i)));
+        v = _mm256_min_epi32(_mm256_max_epi32(v, lo), hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    const int32_t* tails[MAX_MIX_SOURCES];
+    for (uint32_t s = 0; s < sourceCount; s++)
+        tails[s] = sources[s] + i;
+    mixSaturateSSE2(dst + i, tails, sourceCount, values - i);
+}
+//------------------------------------------------------------------------------
+// four fractions, rounded to float like static_cast
+static inline __m128 loadFracSSE2(const double* frac)
+{
+    return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(frac)), _mm_cvtpd_ps(_mm_loadu_pd(frac + 2)));
+}
+//------------------------------------------------------------------------------
+static void blendGainSSE2(const float* prev, const float* cur, const double* frac,
+                          float gain, int16_t* out, uint32_t samples)
+{
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 g    = _mm_set1_ps(gain);
+    const __m128 lo   = _mm_set1_ps(-32768.0f);
+    const __m128 hi   = _mm_set1_ps(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 f0 = loadFracSSE2(frac + i);
+        __m128 f1 = loadFracSSE2(frac + i + 4);
+        __m128 v0 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(prev + i), f0),
+                               _mm_mul_ps(_mm_loadu_ps(cur + i), _mm_sub_ps(one, f0)));
+        __m128 v1 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(prev + i + 4), f1),
+                               _mm_mul_ps(_mm_loadu_ps(cur + i + 4), _mm_sub_ps(one, f1)));
+        v0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v0, g), lo), hi);
+        v1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v1, g), lo), hi);
+        // truncate like static_cast and pack to int16
+        __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    blendGainTail(prev + i, cur + i, frac + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+static void gainSSE2(const float* in, float gain, int16_t* out, uint32_t samples)
+{
+    const __m128 g  = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 v0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), g), lo), hi);
+        __m128 v1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), g), lo), hi);
+        __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    gainScalar(in + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+OPL_PP_TARGET_AVX2
+static inline __m256 loadFracAVX2(const double* frac)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(frac))),
+                                _mm256_cvtpd_ps(_mm256_loadu_pd(frac + 4)), 1);
+}
+//------------------------------------------------------------------------------
+OPL_PP_TARGET_AVX2
+static void blendGainAVX2(const float* prev, const float* cur, const double* frac,
+                          float gain, int16_t* out, uint32_t samples)
+{
+    const __m256 one  = _mm256_set1_ps(1.0f);
+    const __m256 g    = _mm256_set1_ps(gain);
+    const __m256 lo   = _mm256_set1_ps(-32768.0f);
+    const __m256 hi   = _mm256_set1_ps(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256 f0 = loadFracAVX2(frac + i);
+        __m256 f1 = loadFracAVX2(frac + i + 8);
+        __m256 v0 = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(prev + i), f0),
+                                  _mm256_mul_ps(_mm256_loadu_ps(cur + i), _mm256_sub_ps(one, f0)));
+        __m256 v1 = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(prev + i + 8), f1),
+                                  _mm256_mul_ps(_mm256_loadu_ps(cur + i + 8), _mm256_sub_ps(one, f1)));
+        v0 = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v0, g), lo), hi);
+        v1 = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v1, g), lo), hi);
+        // packs works per 128 bit lane, fix the order afterwards
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(v0), _mm256_cvttps_epi32(v1));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    blendGainSSE2(prev + i, cur + i, frac + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+OPL_PP_TARGET_AVX2
+static void gainAVX2(const float* in, float gain, int16_t* out, uint32_t samples)
+{
+    const __m256 g  = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256 v0 = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), g), lo), hi);
+        __m256 v1 = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), g), lo), hi);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(v0), _mm256_cvttps_epi32(v1));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    gainSSE2(in + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+static bool cpuHasAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+//------------------------------------------------------------------------------
+static bool cpuHasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // part of x86-64
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif // OPL_PP_X86
+
+#ifdef OPL_PP_NEON
+//------------------------------------------------------------------------------
+// four fractions, rounded to float like static_cast
+static inline float32x4_t loadFracNEON(const double* frac)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return vcombine_f32(vcvt_f32_f64(vld1q_f64(frac)), vcvt_f32_f64(vld1q_f64(frac + 2)));
+#else
+    // no double vectors on 32 bit ARM
+    const float f[4] = { (float)frac[0], (float)frac[1], (float)frac[2], (float)frac[3] };
+    return vld1q_f32(f);
+#endif
+}
+//------------------------------------------------------------------------------
+static void blendGainNEON(const float* prev, const float* cur, const double* frac,
+                          float gain, int16_t* out, uint32_t samples)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t g   = vdupq_n_f32(gain);
+    const float32x4_t lo  = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi  = vdupq_n_f32(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        float32x4_t f0 = loadFracNEON(frac + i);
+        float32x4_t f1 = loadFracNEON(frac + i + 4);
+        // no fused multiply add, keep the rounding of the x86 kernels
+        float32x4_t v0 = vaddq_f32(vmulq_f32(vld1q_f32(prev + i), f0),
+                                   vmulq_f32(vld1q_f32(cur + i), vsubq_f32(one, f0)));
+        float32x4_t v1 = vaddq_f32(vmulq_f32(vld1q_f32(prev + i + 4), f1),
+                                   vmulq_f32(vld1q_f32(cur + i + 4), vsubq_f32(one, f1)));
+        v0 = vminq_f32(vmaxq_f32(vmulq_f32(v0, g), lo), hi);
+        v1 = vminq_f32(vmaxq_f32(vmulq_f32(v1, g), lo), hi);
+        // vcvtq truncates toward zero like static_cast
+        int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(v0)), vqmovn_s32(vcvtq_s32_f32(v1)));
+        vst1q_s16(out + i, packed);
+    }
+    blendGainTail(prev + i, cur + i, frac + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+static void gainNEON(const float* in, float gain, int16_t* out, uint32_t samples)
+{
+    const float32x4_t g  = vdupq_n_f32(gain);
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        float32x4_t v0 = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in + i), g), lo), hi);
+        float32x4_t v1 = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in + i + 4), g), lo), hi);
+        int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(v0)), vqmovn_s32(vcvtq_s32_f32(v1)));
+        vst1q_s16(out + i, packed);
+    }
+    gainScalar(in + i, gain, out + i, samples - i);
+}
+//------------------------------------------------------------------------------
+static void mixSaturateNEON(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                            uint32_t values)
+{
+    const int32x4_t lo = vdupq_n_s32(-32768);
+    const int32x4_t hi = vdupq_n_s32(32767);
+
+    uint32_t i = 0;
+    for (; i + 4 <= values; i += 4) {
+        int32x4_t v = vld1q_s32(dst + i);
+        for (uint32_t s = 0; s < sourceCount; s++)
+            v = vaddq_s32(v, vld1q_s32(sources[s] + i));
+        vst1q_s32(dst + i, vminq_s32(vmaxq_s32(v, lo), hi));
+    }
+    const int32_t* tails[MAX_MIX_SOURCES];
+    for (uint32_t s = 0; s < sourceCount; s++)
+        tails[s] = sources[s] + i;
+    mixSaturateScalar(dst + i, tails, sourceCount, values - i);
+}
+#endif // OPL_PP_NEON
+
+//------------------------------------------------------------------------------
+bool isKernelSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::Scalar: return true;
+#ifdef OPL_PP_X86
+        case Kernel::SSE2:   return cpuHasSSE2();
+        case Kernel::AVX2:   return cpuHasAVX2();
+#endif
+#ifdef OPL_PP_NEON
+        case Kernel::NEON:   return true;
+#endif
+        default: return false;
+    }
+}
+//------------------------------------------------------------------------------
+Kernel detectKernel()
+{
+    // an environment override helps comparing the kernels
+    if (const char* env = std::getenv("OPL_POSTPROCESS_SCALAR")) {
+        if (env[0] == '1')
+            return Kernel::Scalar;
+    }
+
+    if (isKernelSupported(Kernel::AVX2)) return Kernel::AVX2;
+    if (isKernelSupported(Kernel::SSE2)) return Kernel::SSE2;
+    if (isKernelSupported(Kernel::NEON)) return Kernel::NEON;
+    return Kernel::Scalar;
+}
+//------------------------------------------------------------------------------
+BlendGainFn getKernel(Kernel kernel)
+{
+    if (!isKernelSupported(kernel))
+        return blendGainScalar;
+
+    switch (kernel)
+    {
+#ifdef OPL_PP_X86
+        case Kernel::SSE2:   return blendGainSSE2;
+        case Kernel::AVX2:   return blendGainAVX2;
+#endif
+#ifdef OPL_PP_NEON
+        case Kernel::NEON:   return blendGainNEON;
+#endif
+        default: return blendGainScalar;
+    }
+}
+//------------------------------------------------------------------------------
+GainFn getGainKernel(Kernel kernel)
+{
+    if (!isKernelSupported(kernel))
+        return gainScalar;
+
+    switch (kernel)
+    {
+#ifdef OPL_PP_X86
+        case Kernel::SSE2:   return gainSSE2;
+        case Kernel::AVX2:   return gainAVX2;
+#endif
+#ifdef OPL_PP_NEON
+        case Kernel::NEON:   return gainNEON;
+#endif
+        default: return gainScalar;
+    }
+}
+//------------------------------------------------------------------------------
+MixFn getMixKernel(Kernel kernel)
+{
+    if (!isKernelSupported(kernel))
+        return mixSaturateScalar;
+
+    switch (kernel)
+    {
+#ifdef OPL_PP_X86
+        case Kernel::SSE2:   return mixSaturateSSE2;
+        case Kernel::AVX2:   return mixSaturateAVX2;
+#endif
+#ifdef OPL_PP_NEON
+        case Kernel::NEON:   return mixSaturateNEON;
+#endif
+        default: return mixSaturateScalar;
+    }
+}
+//------------------------------------------------------------------------------
+const char* getKernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::SSE2: return "SSE2";
+        case Kernel::AVX2: return "AVX2";
+        case Kernel::NEON: return "NEON";
+        default:           return "Scalar";
+    }
+}
+//------------------------------------------------------------------------------
+int compareToScalar(Kernel kernel, uint32_t samples)
+{
+    std::vector<float> prev(samples), cur(samples);
+    std::vector<double> frac(samples);
+    std::vector<int16_t> outRef(samples), outTest(samples);
+
+    // deterministic test signal, exceeding the int16 range to test saturation
+    uint32_t seed = 0x4F504C33; // "OPL3"
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for (uint32_t i = 0; i < samples; i++) {
+        prev[i] = (float)((int32_t)(next() % 80000) - 40000);
+        cur[i]  = (float)((int32_t)(next() % 80000) - 40000);
+        frac[i] = (double)(next() % 65536) / 65536.0 + (double)(next() % 4096) / 268435456.0;
+    }
+
+    const float gain = 1.3f;
+    blendGainScalar(prev.data(), cur.data(), frac.data(), gain, outRef.data(), samples);
+    getKernel(kernel)(prev.data(), cur.data(), frac.data(), gain, outTest.data(), samples);
+
+    int maxDiff = 0;
+    for (uint32_t i = 0; i < samples; i++)
+        maxDiff = std::max(maxDiff, std::abs(outRef[i] - outTest[i]));
+    return maxDiff;
+}
+
+//------------------------------------------------------------------------------
+int compareGainToScalar(Kernel kernel, uint32_t samples)
+{
+    std::vector<float> in(samples);
+    std::vector<int16_t> outRef(samples), outTest(samples);
+
+    uint32_t seed = 0x4F504C32; // "OPL2"
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for (uint32_t i = 0; i < samples; i++)
+        in[i] = (float)((int32_t)(next() % 80000) - 40000);
+
+    // the gains of the render modes
+    int maxDiff = 0;
+    for (float gain : { 0.9f, 1.0f, 1.05f, 1.2f, 1.3f }) {
+        gainScalar(in.data(), gain, outRef.data(), samples);
+        getGainKernel(kernel)(in.data(), gain, outTest.data(), samples);
+        for (uint32_t i = 0; i < samples; i++)
+            maxDiff = std::max(maxDiff, std::abs(outRef[i] - outTest[i]));
+    }
+    return maxDiff;
+}
+
+} // namespace OplPostProcess
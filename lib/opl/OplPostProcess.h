@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Post processing of the OPL output: blend interpolation, gain and
+// saturation on interleaved stereo blocks, and the mix of several chips.
+//
+// The kernel is selected at runtime (AVX2 / SSE2 / NEON / scalar).
+// The scalar references are the math of the original fillBuffer, bit for
+// bit: the blend in double with the double fraction, the raw gain as a
+// float product. The SIMD blend calculates in float and may differ from
+// its reference by TOLERANCE_LSB, the SIMD gain is exact.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+
+namespace OplPostProcess {
+
+    enum class Kernel {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    // max difference of a SIMD blend kernel against the scalar reference
+    constexpr int TOLERANCE_LSB = 1;
+
+    // out[i] = saturate16((prev[i] * frac[i] + cur[i] * (1 - frac[i])) * gain)
+    // all arrays hold interleaved stereo, samples = frames * 2
+    using BlendGainFn = void (*)(const float* prev, const float* cur, const double* frac,
+                                 float gain, int16_t* out, uint32_t samples);
+
+    // out[i] = saturate16(in[i] * gain), the raw modes
+    using GainFn = void (*)(const float* in, float gain, int16_t* out, uint32_t samples);
+
+    // scalar references
+    void blendGainScalar(const float* prev, const float* cur, const double* frac,
+                         float gain, int16_t* out, uint32_t samples);
+    void gainScalar(const float* in, float gain, int16_t* out, uint32_t samples);
+
+    // float output: same blend and gain scaled to -1..1, no clamp.
+    // plain loops in the operation order of the SIMD kernels, the compiler
+    // vectorizes them
+    void blendGainF32(const float* prev, const float* cur, const double* frac,
+                      float gain, float* out, uint32_t samples);
+    void gainF32(const float* in, float gain, float* out, uint32_t samples);
+
+    // dst[i] = saturate16(dst[i] + sources[0][i] + ... + sources[n - 1][i])
+    // mixes the chip samples of several chips into the first one in one
+    // pass. Integer math, every kernel gives the scalar result.
+    // sourceCount <= MAX_MIX_SOURCES
+    constexpr uint32_t MAX_MIX_SOURCES = 16;
+    using MixFn = void (*)(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                           uint32_t values);
+
+    void mixSaturateScalar(int32_t* dst, const int32_t* const* sources, uint32_t sourceCount,
+                           uint32_t values);
+
+    // best kernel supported by this CPU
+    Kernel detectKernel();
+    bool isKernelSupported(Kernel kernel);
+    BlendGainFn getKernel(Kernel kernel);
+    GainFn getGainKernel(Kernel kernel);
+    MixFn getMixKernel(Kernel kernel);
+    const char* getKernelName(Kernel kernel);
+
+    // renders a test signal with the blend kernel and the scalar reference,
+    // returns the max difference in LSB (should be <= TOLERANCE_LSB)
+    int compareToScalar(Kernel kernel, uint32_t samples = 4096);
+    // the same for the gain kernel (should be 0)
+    int compareGainToScalar(Kernel kernel, uint32_t samples = 4096);
+
+} // namespace OplPostProcess
@@ -0,0 +1,40 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Scratch block of interleaved stereo frames (int16 or float, the frame
+// size is given to allocate) that pullOutput renders into before it hands
+// the frames to the sink.
+// The storage is allocated once (allocate) outside the audio thread.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+class OplRenderBlock
+{
+public:
+    static constexpr uint32_t CHANNELS = 2;
+
+private:
+    std::unique_ptr<uint8_t[]> mData;
+    uint32_t mFrameBytes = CHANNELS * sizeof(int16_t);
+    uint32_t mCapacity = 0;   // in frames
+
+public:
+    // allocates the storage, NOT for the audio thread!
+    bool allocate(uint32_t frames, uint32_t frameBytes = CHANNELS * sizeof(int16_t))
+    {
+        if (frames == 0 || frameBytes == 0)
+            return false;
+        mData.reset(new uint8_t[frames * frameBytes]());
+        mFrameBytes = frameBytes;
+        mCapacity = frames;
+        return true;
+    }
+
+    uint32_t capacity() const { return mCapacity; }
+    uint32_t frameBytes() const { return mFrameBytes; }
+    uint8_t* data() { return mData.get(); }
+};
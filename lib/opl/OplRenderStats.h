@@ -0,0 +1,179 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Timing of the audio callback (OplController::pullOutput): render time
+// against the buffer duration, the load histogram, the time spent on the
+// data mutex, missed locks (silence), overruns and the command queue depth.
+//
+// The audio thread is the only writer (record), any thread may take a
+// snapshot. reset only raises a flag, the audio thread clears on its next
+// callback so no counter has two writers.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class OplRenderStats
+{
+public:
+    static constexpr uint32_t LOAD_BUCKETS = 12;  // 10% steps, the last is >= 110%
+    static constexpr uint32_t HISTORY = 256;      // load of the recent callbacks
+
+    struct Snapshot {
+        uint64_t callbacks = 0;
+        uint64_t frames = 0;
+        uint32_t lockMisses = 0;      // callbacks answered with silence
+        uint32_t overruns = 0;        // render took longer than the buffer plays
+        uint32_t lastFrames = 0;      // frames of the last callback
+        uint32_t maxFrames = 0;
+        double lastRenderUs = 0.0;
+        double avgRenderUs = 0.0;
+        double worstRenderUs = 0.0;
+        double lastBufferUs = 0.0;    // play time of the last callback buffer
+        double lastLockWaitUs = 0.0;
+        double worstLockWaitUs = 0.0;
+        uint32_t queueDepth = 0;      // commands pending at the last callback
+        uint32_t maxQueueDepth = 0;
+        uint64_t loadHistogram[LOAD_BUCKETS] = {};
+        float loadHistory[HISTORY] = {}; // percent, oldest first
+
+        uint32_t underruns() const { return lockMisses + overruns; }
+        double lastLoad() const { return lastBufferUs > 0.0 ? lastRenderUs / lastBufferUs : 0.0; }
+
+        bool writeCsv(const std::string& filename) const
+        {
+            std::FILE* file = std::fopen(filename.c_str(), "w");
+            if (!file)
+                return false;
+            std::fprintf(file, "key,value\n");
+            std::fprintf(file, "callbacks,%llu\n", (unsigned long long)callbacks);
+            std::fprintf(file, "frames,%llu\n", (unsigned long long)frames);
+            std::fprintf(file, "last_frames,%u\nmax_frames,%u\n", lastFrames, maxFrames);
+            std::fprintf(file, "lock_misses,%u\noverruns,%u\n", lockMisses, overruns);
+            std::fprintf(file, "last_render_us,%.2f\navg_render_us,%.2f\nworst_render_us,%.2f\n",
+                         lastRenderUs, avgRenderUs, worstRenderUs);
+            std::fprintf(file, "last_buffer_us,%.2f\n", lastBufferUs);
+            std::fprintf(file, "last_lock_wait_us,%.2f\nworst_lock_wait_us,%.2f\n", lastLockWaitUs, worstLockWaitUs);
+            std::fprintf(file, "queue_depth,%u\nmax_queue_depth,%u\n", queueDepth, maxQueueDepth);
+            for (uint32_t i = 0; i < LOAD_BUCKETS; i++) {
+                if (i + 1 < LOAD_BUCKETS)
+                    std::fprintf(file, "load_%u_%u,%llu\n", i * 10, (i + 1) * 10, (unsigned long long)loadHistogram[i]);
+                else
+                    std::fprintf(file, "load_%u_up,%llu\n", i * 10, (unsigned long long)loadHistogram[i]);
+            }
+            for (uint32_t i = 0; i < HISTORY; i++)
+                std::fprintf(file, "history_%u,%.1f\n", i, loadHistory[i]);
+            return std::fclose(file) == 0;
+        }
+    };
+
+private:
+    std::atomic<uint64_t> mCallbacks = 0;
+    std::atomic<uint64_t> mFrames = 0;
+    std::atomic<uint64_t> mRenderNsTotal = 0;
+    std::atomic<uint32_t> mLockMisses = 0;
+    std::atomic<uint32_t> mOverruns = 0;
+    std::atomic<uint32_t> mLastFrames = 0;
+    std::atomic<uint32_t> mMaxFrames = 0;
+    std::atomic<int64_t> mLastRenderNs = 0;
+    std::atomic<int64_t> mWorstRenderNs = 0;
+    std::atomic<int64_t> mLastBufferNs = 0;
+    std::atomic<int64_t> mLastLockWaitNs = 0;
+    std::atomic<int64_t> mWorstLockWaitNs = 0;
+    std::atomic<uint32_t> mQueueDepth = 0;
+    std::atomic<uint32_t> mMaxQueueDepth = 0;
+    std::atomic<uint64_t> mLoadHistogram[LOAD_BUCKETS] = {};
+    std::atomic<float> mLoadHistory[HISTORY] = {};
+    std::atomic<uint32_t> mHistoryPos = 0;
+    std::atomic<bool> mResetRequested = false;
+
+    static constexpr auto relaxed = std::memory_order_relaxed;
+
+    void clear()
+    {
+        mCallbacks.store(0, relaxed);
+        mFrames.store(0, relaxed);
+        mRenderNsTotal.store(0, relaxed);
+        mLockMisses.store(0, relaxed);
+        mOverruns.store(0, relaxed);
+        mMaxFrames.store(0, relaxed);
+        mWorstRenderNs.store(0, relaxed);
+        mWorstLockWaitNs.store(0, relaxed);
+        mMaxQueueDepth.store(0, relaxed);
+        for (auto& bucket : mLoadHistogram)
+            bucket.store(0, relaxed);
+        for (auto& load : mLoadHistory)
+            load.store(0.f, relaxed);
+        mHistoryPos.store(0, relaxed);
+    }
+
+public:
+    // audio thread, once per callback
+    void record(uint32_t frames, int rate, int64_t lockWaitNs, int64_t renderNs,
+                bool lockMissed, uint32_t queueDepth)
+    {
+        if (mResetRequested.exchange(false, relaxed))
+            clear();
+
+        const int64_t bufferNs = rate > 0 ? (int64_t)frames * 1000000000ll / rate : 0;
+        mCallbacks.store(mCallbacks.load(relaxed) + 1, relaxed);
+        mFrames.store(mFrames.load(relaxed) + frames, relaxed);
+        mLastFrames.store(frames, relaxed);
+        mMaxFrames.store(std::max(mMaxFrames.load(relaxed), frames), relaxed);
+        mLastLockWaitNs.store(lockWaitNs, relaxed);
+        mWorstLockWaitNs.store(std::max(mWorstLockWaitNs.load(relaxed), lockWaitNs), relaxed);
+        mQueueDepth.store(queueDepth, relaxed);
+        mMaxQueueDepth.store(std::max(mMaxQueueDepth.load(relaxed), queueDepth), relaxed);
+        mLastBufferNs.store(bufferNs, relaxed);
+        if (lockMissed)
+            mLockMisses.store(mLockMisses.load(relaxed) + 1, relaxed);
+
+        mLastRenderNs.store(renderNs, relaxed);
+        mRenderNsTotal.store(mRenderNsTotal.load(relaxed) + renderNs, relaxed);
+        mWorstRenderNs.store(std::max(mWorstRenderNs.load(relaxed), renderNs), relaxed);
+        if (bufferNs > 0 && renderNs > bufferNs)
+            mOverruns.store(mOverruns.load(relaxed) + 1, relaxed);
+
+        const float load = bufferNs > 0 ? 100.f * (float)renderNs / (float)bufferNs : 0.f;
+        const uint32_t bucket = std::min<uint32_t>((uint32_t)(load / 10.f), LOAD_BUCKETS - 1);
+        mLoadHistogram[bucket].store(mLoadHistogram[bucket].load(relaxed) + 1, relaxed);
+
+        const uint32_t pos = mHistoryPos.load(relaxed);
+        mLoadHistory[pos % HISTORY].store(load, relaxed);
+        mHistoryPos.store(pos + 1, relaxed);
+    }
+
+    // any thread, applied by the audio thread on its next callback
+    void reset() { mResetRequested.store(true, relaxed); }
+
+    // any thread, the fields are read one by one (not one consistent moment)
+    Snapshot snapshot() const
+    {
+        Snapshot s;
+        s.callbacks = mCallbacks.load(relaxed);
+        s.frames = mFrames.load(relaxed);
+        s.lockMisses = mLockMisses.load(relaxed);
+        s.overruns = mOverruns.load(relaxed);
+        s.lastFrames = mLastFrames.load(relaxed);
+        s.maxFrames = mMaxFrames.load(relaxed);
+        s.lastRenderUs = mLastRenderNs.load(relaxed) / 1000.0;
+        s.worstRenderUs = mWorstRenderNs.load(relaxed) / 1000.0;
+        s.avgRenderUs = s.callbacks ? (double)mRenderNsTotal.load(relaxed) / 1000.0 / (double)s.callbacks : 0.0;
+        s.lastBufferUs = mLastBufferNs.load(relaxed) / 1000.0;
+        s.lastLockWaitUs = mLastLockWaitNs.load(relaxed) / 1000.0;
+        s.worstLockWaitUs = mWorstLockWaitNs.load(relaxed) / 1000.0;
+        s.queueDepth = mQueueDepth.load(relaxed);
+        s.maxQueueDepth = mMaxQueueDepth.load(relaxed);
+        for (uint32_t i = 0; i < LOAD_BUCKETS; i++)
+            s.loadHistogram[i] = mLoadHistogram[i].load(relaxed);
+        const uint32_t pos = mHistoryPos.load(relaxed);
+        for (uint32_t i = 0; i < HISTORY; i++)
+            s.loadHistory[i] = mLoadHistory[(pos + i) % HISTORY].load(relaxed);
+        return s;
+    }
+};
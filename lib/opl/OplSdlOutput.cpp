@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplSdlOutput.h"
+#include "OplController.h"
+#include "OplLog.h"
+
+#include <cstdlib>
+
+#ifdef FLUX_ENGINE
+#include <audio/fluxAudio.h>
+#endif
+
+//------------------------------------------------------------------------------
+void OplSdlOutput::audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+{
+    (void)stream;
+    (void)total_amount;
+    auto* output = static_cast<OplSdlOutput*>(userdata);
+    if (!output || !output->mController || additional_amount <= 0)
+        return;
+
+    OplAudioAllocations::Scope audioThread;
+    OplController* controller = output->mController;
+    const uint32_t frames = additional_amount / controller->getOutputSpec().bytesPerFrame();
+    controller->pullOutput(frames, &OplSdlOutput::putStreamData, output);
+}
+//------------------------------------------------------------------------------
+void OplSdlOutput::putStreamData(void* userdata, const void* data, uint32_t bytes)
+{
+    auto* output = static_cast<OplSdlOutput*>(userdata);
+    SDL_PutAudioStreamData(output->mStream, data, (int)bytes);
+}
+//------------------------------------------------------------------------------
+bool OplSdlOutput::getDeviceSpec(OplOutputSpec& spec) const
+{
+    SDL_AudioSpec deviceSpec;
+    int deviceFrames = 0;
+    if (!SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &deviceSpec, &deviceFrames))
+        return false;
+
+    spec.rate = deviceSpec.freq;
+    spec.format = (deviceSpec.format == SDL_AUDIO_F32) ? OplOutputSpec::Format::F32 : OplOutputSpec::Format::S16;
+    return true;
+}
+//------------------------------------------------------------------------------
+uint32_t OplSdlOutput::getBufferFrames() const
+{
+    if (const char* hint = SDL_GetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES))
+        return (uint32_t)std::strtoul(hint, nullptr, 10);
+    return 0;
+}
+//------------------------------------------------------------------------------
+bool OplSdlOutput::open(OplController& controller, const OplOutputSpec& outputSpec)
+{
+    close();
+
+    SDL_AudioSpec spec;
+    spec.format = (outputSpec.format == OplOutputSpec::Format::F32) ? SDL_AUDIO_F32 : SDL_AUDIO_S16;
+    spec.channels = OplOutputSpec::CHANNELS;
+    spec.freq = outputSpec.rate;
+
+    mStream = SDL_CreateAudioStream(&spec, &spec);
+    if (!mStream) {
+        Log("SDL_OpenAudioDeviceStream failed: %s", SDL_GetError());
+        return false;
+    }
+    mController = &controller;
+    SDL_SetAudioStreamGetCallback(mStream, OplSdlOutput::audio_callback, this);
+
+    #ifdef FLUX_ENGINE
+        AudioManager.bindStream(mStream);
+    #else
+        SDL_AudioDeviceID dev = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, NULL);
+
+        if (dev == 0) {
+            Log("Failed to open audio device: %s", SDL_GetError());
+            close();
+            return false;
+        }
+
+        if (!SDL_BindAudioStream(dev, mStream)) {
+            Log("Failed to bind stream: %s", SDL_GetError());
+            close();
+            return false;
+        }
+    #endif
+
+    SDL_ResumeAudioStreamDevice(mStream);
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplSdlOutput::close()
+{
+    if (mStream) {
+        SDL_FlushAudioStream(mStream);
+        SDL_SetAudioStreamGetCallback(mStream, NULL, NULL);
+        SDL_DestroyAudioStream(mStream);
+        mStream = nullptr;
+    }
+    mController = nullptr;
+}
+//------------------------------------------------------------------------------
+float OplSdlOutput::getVolume() const
+{
+    if (!mStream)
+        return 0.f;
+    float gain = SDL_GetAudioStreamGain(mStream);
+    return (gain < 0.0f) ? 0.0f : gain;
+}
+//------------------------------------------------------------------------------
+bool OplSdlOutput::setVolume(float value)
+{
+    if (mStream)
+        return SDL_SetAudioStreamGain(mStream, value);
+    return false;
+}
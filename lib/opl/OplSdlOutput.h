@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// SDL3 output backend: an SDL_AudioStream in the render format whose get
+// callback pulls from the controller. Bound to the OhmFlux AudioManager when
+// built inside the engine, to the default playback device otherwise.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "OplAudioOutput.h"
+
+class OplSdlOutput : public OplAudioOutput
+{
+private:
+    SDL_AudioStream* mStream = nullptr;
+    OplController* mController = nullptr;
+
+    static void SDLCALL audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+    static void putStreamData(void* userdata, const void* data, uint32_t bytes);
+
+public:
+    OplSdlOutput() = default;
+    ~OplSdlOutput() override { close(); }
+    OplSdlOutput(const OplSdlOutput&) = delete;
+    OplSdlOutput& operator=(const OplSdlOutput&) = delete;
+
+    bool getDeviceSpec(OplOutputSpec& spec) const override;
+    uint32_t getBufferFrames() const override;
+
+    bool open(OplController& controller, const OplOutputSpec& spec) override;
+    void close() override;
+    bool isOpen() const override { return mStream != nullptr; }
+
+    float getVolume() const override;
+    bool setVolume(float value) override;
+
+    SDL_AudioStream* getAudioStream() { return mStream; }
+};
@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplSincResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//------------------------------------------------------------------------------
+// modified bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 50; k++) {
+        term *= q / (double)(k * k);
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+//------------------------------------------------------------------------------
+bool OplSincResampler::configure(double inRate, double outRate, uint32_t maxInput)
+{
+    if (inRate <= 0.0 || outRate <= 0.0 || maxInput == 0)
+        return false;
+
+    // the left taps must stay inside the kept history
+    const double step = inRate / outRate;
+    if (step >= (double)(HALF - 2))
+        return false;
+
+    mInRate = inRate;
+    mOutRate = outRate;
+    mStep = step;
+
+    // cutoff relative to the input nyquist, a bit below the lower nyquist
+    const double cutoff = std::min(1.0, outRate / inRate) * 0.91;
+    const double i0Beta = besselI0(KAISER_BETA);
+
+    mTable.assign((PHASES + 1) * TAPS, 0.f);
+    for (uint32_t p = 0; p <= PHASES; p++) {
+        const double d = (double)p / (double)PHASES;
+        double coef[TAPS];
+        double sum = 0.0;
+        for (uint32_t j = 0; j < TAPS; j++) {
+            // distance of tap j to the output position
+            const double x = (double)j - (double)(HALF - 1) - d;
+            const double t = x / (double)HALF;
+            const double w = (std::fabs(t) <= 1.0)
+                ? besselI0(KAISER_BETA * std::sqrt(1.0 - t * t)) / i0Beta : 0.0;
+            const double px = M_PI * cutoff * x;
+            const double sinc = (std::fabs(px) < 1e-12) ? 1.0 : std::sin(px) / px;
+            coef[j] = cutoff * sinc * w;
+            sum += coef[j];
+        }
+        // unity gain at DC for every phase
+        for (uint32_t j = 0; j < TAPS; j++)
+            mTable[p * TAPS + j] = (float)(coef[j] / sum);
+    }
+
+    mCapacity = maxInput + TAPS * 2;
+    mBuffer.assign(mCapacity * 2, 0.f);
+    reset();
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplSincResampler::reset()
+{
+    std::fill(mBuffer.begin(), mBuffer.end(), 0.f);
+    // HALF samples of silence in front of the first input sample
+    mFill = HALF;
+    mPos = (double)HALF;
+}
+//------------------------------------------------------------------------------
+uint32_t OplSincResampler::inputNeeded(uint32_t frames) const
+{
+    if (frames == 0)
+        return 0;
+    // same formula as process, so both agree on the last sample
+    const uint32_t n = (uint32_t)(mPos + (double)(frames - 1) * mStep);
+    const uint32_t required = n + HALF + 1;
+    return (required > mFill) ? required - mFill : 0;
+}
+//------------------------------------------------------------------------------
+uint32_t OplSincResampler::framesFor(uint32_t input) const
+{
+    const double avail = (double)(mFill + input) - (double)HALF - mPos;
+    if (avail < 0.0)
+        return 0;
+    uint32_t frames = (uint32_t)(avail / mStep) + 1;
+    while (frames > 0 && inputNeeded(frames) > input)
+        frames--;
+    while (inputNeeded(frames + 1) <= input)
+        frames++;
+    return frames;
+}
+//------------------------------------------------------------------------------
+float* OplSincResampler::pushPtr(uint32_t count)
+{
+    if (mFill + count > mCapacity)
+        return nullptr;
+    return mBuffer.data() + mFill * 2;
+}
+//------------------------------------------------------------------------------
+void OplSincResampler::commitPush(uint32_t count)
+{
+    mFill = std::min(mFill + count, mCapacity);
+}
+//------------------------------------------------------------------------------
+void OplSincResampler::process(float* out, uint32_t frames)
+{
+    const float* table = mTable.data();
+    float* buf = mBuffer.data();
+
+    for (uint32_t k = 0; k < frames; k++) {
+        const double pos = mPos + (double)k * mStep;
+        const uint32_t n = (uint32_t)pos;
+        const double phase = (pos - (double)n) * (double)PHASES;
+        const uint32_t ph = (uint32_t)phase;
+        const float t = (float)(phase - (double)ph);
+
+        const float* c0 = table + ph * TAPS;
+        const float* c1 = c0 + TAPS;
+        const float* x = buf + (n + 1 - HALF) * 2;
+
+        float l0 = 0.f, r0 = 0.f, l1 = 0.f, r1 = 0.f;
+        for (uint32_t j = 0; j < TAPS; j++) {
+            l0 += c0[j] * x[j * 2 + 0];
+            r0 += c0[j] * x[j * 2 + 1];
+            l1 += c1[j] * x[j * 2 + 0];
+            r1 += c1[j] * x[j * 2 + 1];
+        }
+        out[k * 2 + 0] = l0 + (l1 - l0) * t;
+        out[k * 2 + 1] = r0 + (r1 - r0) * t;
+    }
+    mPos += (double)frames * mStep;
+
+    // drop the samples left of the next first tap
+    uint32_t drop = (uint32_t)mPos + 1 - HALF;
+    drop = std::min(drop, mFill);
+    if (drop > 0) {
+        std::memmove(buf, buf + drop * 2, (mFill - drop) * 2 * sizeof(float));
+        mFill -= drop;
+        mPos -= (double)drop;
+    }
+}
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Band limited polyphase resampler (Kaiser windowed sinc) for interleaved
+// stereo blocks. The coefficient table is built in configure, the render
+// path only pushes input and pulls output.
+//
+// usage per block:
+//   n = inputNeeded(frames)          // may be 0
+//   fill pushPtr(n) ... commitPush(n)
+//   process(out, frames)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class OplSincResampler
+{
+public:
+    static constexpr uint32_t TAPS   = 32;  // per phase, even
+    static constexpr uint32_t HALF   = TAPS / 2;
+    static constexpr uint32_t PHASES = 256; // linear interpolated between phases
+    static constexpr double   KAISER_BETA = 8.0;
+
+private:
+    // (PHASES + 1) * TAPS, the extra phase simplifies the interpolation
+    std::vector<float> mTable;
+    // interleaved stereo history + new input
+    std::vector<float> mBuffer;
+    uint32_t mCapacity = 0; // in samples (frames of the input)
+    uint32_t mFill = 0;     // valid samples in mBuffer
+    double mPos = 0.0;      // input position of the next output frame
+    double mStep = 1.0;     // input samples per output frame
+    double mInRate = 0.0;
+    double mOutRate = 0.0;
+
+public:
+    // builds the table, NOT for the audio thread!
+    // maxInput: max samples pushed between two process calls
+    bool configure(double inRate, double outRate, uint32_t maxInput);
+    void reset();
+
+    bool isConfigured() const { return !mTable.empty(); }
+    double getInRate() const { return mInRate; }
+    double getOutRate() const { return mOutRate; }
+
+    // input samples missing to produce frames output frames
+    uint32_t inputNeeded(uint32_t frames) const;
+    // max output frames which can be produced pushing at most input samples
+    uint32_t framesFor(uint32_t input) const;
+
+    // contiguous space for count interleaved stereo samples
+    float* pushPtr(uint32_t count);
+    void commitPush(uint32_t count);
+
+    // writes frames interleaved stereo frames, the input must be there
+    void process(float* out, uint32_t frames);
+};
@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Hands immutable, reference counted versions (std::shared_ptr<const T>)
+// from one producer (GUI) to one consumer (audio thread).
+//
+// The consumer never frees: the version it replaces is parked in a retired
+// slot and released by the producer on its next publish. The spin lock only
+// guards a few pointer moves, nothing is allocated or freed while held.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class OplSnapshotExchange
+{
+public:
+    using Ptr = std::shared_ptr<const T>;
+
+private:
+    std::atomic_flag mLock = ATOMIC_FLAG_INIT;
+    std::atomic<bool> mHasPending = false;
+    Ptr mPending;   // published, not picked up yet
+    Ptr mRetired;   // replaced by the consumer, released by the producer
+
+    void lock()
+    {
+        while (mLock.test_and_set(std::memory_order_acquire)) {}
+    }
+    void unlock() { mLock.clear(std::memory_order_release); }
+
+public:
+    // producer: a version not picked up yet is replaced
+    void publish(Ptr next)
+    {
+        Ptr dropPending, dropRetired;
+        lock();
+        dropPending = std::move(mPending);
+        dropRetired = std::move(mRetired);
+        mPending = std::move(next);
+        mHasPending.store(mPending != nullptr, std::memory_order_release);
+        unlock();
+    } // the dropped versions are released here, on the producer side
+
+    // producer: forget a pending version and release the retired one
+    void clear() { publish(nullptr); }
+
+    // consumer: swaps current for the published version, returns false if
+    // there is none. Every publish empties the retired slot, so parking the
+    // old version never releases anything here.
+    bool adopt(Ptr& current)
+    {
+        if (!mHasPending.load(std::memory_order_acquire))
+            return false;
+        lock();
+        const bool adopted = mPending != nullptr;
+        if (adopted) {
+            std::swap(current, mPending);
+            std::swap(mRetired, mPending); // mRetired is empty
+        }
+        mHasPending.store(false, std::memory_order_relaxed);
+        unlock();
+        return adopted;
+    }
+};
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplSongHistory.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+// cells of a step are sorted by row, channel: merging is one linear pass
+static uint32_t cellKey(const OplPatternStore::CellChange& change)
+{
+    return ((uint32_t)change.row << 8) | change.channel;
+}
+//------------------------------------------------------------------------------
+bool OplSongHistory::record(const SongDataFMS& before, const SongDataFMS& after, const char* label, bool coalesce)
+{
+    Step step;
+    step.label = label;
+    step.lengthBefore = before.song_length;
+    step.lengthAfter = after.song_length;
+    step.delayBefore = before.song_delay;
+    step.delayAfter = after.song_delay;
+    step.typing = coalesce;
+    step.time = std::chrono::steady_clock::now();
+    after.notes.diff(before.notes, step.cells);
+
+    if (step.cells.empty() && step.lengthBefore == step.lengthAfter && step.delayBefore == step.delayAfter)
+        return false;
+
+    std::sort(step.cells.begin(), step.cells.end(),
+              [](const CellChange& a, const CellChange& b) { return cellKey(a) < cellKey(b); });
+
+    for (const Step& redo : mRedo)
+        mBytes -= redo.getMemoryBytes();
+    mRedo.clear();
+
+    // typing burst: merge into the previous typing step, the first before
+    // value of a cell wins
+    if (coalesce && !mUndo.empty() && mUndo.back().typing
+        && std::chrono::duration_cast<std::chrono::milliseconds>(step.time - mUndo.back().time).count() <= COALESCE_MS)
+    {
+        Step& last = mUndo.back();
+        mBytes -= last.getMemoryBytes();
+
+        std::vector<CellChange> merged;
+        merged.reserve(last.cells.size() + step.cells.size());
+        auto old = last.cells.begin();
+        auto now = step.cells.begin();
+        while (old != last.cells.end() || now != step.cells.end()) {
+            CellChange change;
+            if (now == step.cells.end() || (old != last.cells.end() && cellKey(*old) < cellKey(*now)))
+                change = *old++;
+            else if (old == last.cells.end() || cellKey(*now) < cellKey(*old))
+                change = *now++;
+            else {
+                change = *old++;
+                change.after = (now++)->after;
+            }
+            if (change.before != change.after)
+                merged.push_back(change);
+        }
+        last.cells = std::move(merged);
+        last.lengthAfter = step.lengthAfter;
+        last.delayAfter = step.delayAfter;
+        last.time = step.time;
+
+        if (last.cells.empty() && last.lengthBefore == last.lengthAfter && last.delayBefore == last.delayAfter)
+            mUndo.pop_back(); // typed back to where the burst started
+        else
+            mBytes += last.getMemoryBytes();
+        trim();
+        // a burst bigger than the budget ends, the next key starts a new
+        // step and this one can be dropped
+        if (!mUndo.empty() && mUndo.back().getMemoryBytes() > mBudget)
+            mUndo.back().typing = false;
+        return true;
+    }
+
+    step.cells.shrink_to_fit();
+    mBytes += step.getMemoryBytes();
+    mUndo.push_back(std::move(step));
+    trim();
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplSongHistory::apply(const Step& step, SongDataFMS& sd, bool forward) const
+{
+    for (const CellChange& change : step.cells)
+        sd.setNote(change.row, change.channel, forward ? change.after : change.before);
+    sd.song_length = forward ? step.lengthAfter : step.lengthBefore;
+    sd.song_delay = forward ? step.delayAfter : step.delayBefore;
+}
+//------------------------------------------------------------------------------
+bool OplSongHistory::undo(SongDataFMS& sd)
+{
+    if (mUndo.empty())
+        return false;
+    apply(mUndo.back(), sd, false);
+    mRedo.push_back(std::move(mUndo.back()));
+    mUndo.pop_back();
+    mRedo.back().typing = false;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool OplSongHistory::redo(SongDataFMS& sd)
+{
+    if (mRedo.empty())
+        return false;
+    apply(mRedo.back(), sd, true);
+    mUndo.push_back(std::move(mRedo.back()));
+    mRedo.pop_back();
+    return true;
+}
+//------------------------------------------------------------------------------
+void OplSongHistory::clear()
+{
+    mUndo.clear();
+    mRedo.clear();
+    mBytes = 0;
+}
+//------------------------------------------------------------------------------
+// drops the oldest steps until the budget fits, the newest undo step is
+// always kept even if it alone is bigger
+void OplSongHistory::trim()
+{
+    while (mBytes > mBudget && !mRedo.empty()) {
+        mBytes -= mRedo.front().getMemoryBytes();
+        mRedo.pop_front();
+    }
+    while (mBytes > mBudget && mUndo.size() > 1) {
+        mBytes -= mUndo.front().getMemoryBytes();
+        mUndo.pop_front();
+    }
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Undo / redo of song edits. A step stores only the changed cells (before
+// and after value) plus song_length and song_delay, found by comparing the
+// song with its version before the edit (OplPatternStore::diff), so any
+// edit function works without knowing about the history.
+//
+// * typing: a step recorded with coalesce = true merges into the previous
+//   typing step when it follows within COALESCE_MS
+// * the steps are bounded by a byte budget, the oldest are dropped first,
+//   a typing burst which outgrows the budget ends
+//
+// usage:
+//   before = snapshot of the song
+//   ... edit the song ...
+//   history.record(*before, song, "Paste");
+//   history.undo(song);
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "OplController.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+class OplSongHistory
+{
+public:
+    using SongDataFMS = OplController::SongDataFMS;
+    using CellChange = OplPatternStore::CellChange;
+
+    static constexpr int64_t COALESCE_MS = 1000;
+    static constexpr size_t DEFAULT_BUDGET = 256 * 1024;
+
+    struct Step {
+        const char* label = "";
+        std::vector<CellChange> cells;
+        uint16_t lengthBefore = 0, lengthAfter = 0;
+        uint8_t delayBefore = 0, delayAfter = 0;
+        bool typing = false;
+        std::chrono::steady_clock::time_point time;
+
+        size_t getMemoryBytes() const { return sizeof(Step) + cells.capacity() * sizeof(CellChange); }
+    };
+
+private:
+    std::deque<Step> mUndo;   // oldest first
+    std::deque<Step> mRedo;   // next redo last
+    size_t mBudget = DEFAULT_BUDGET;
+    size_t mBytes = 0;        // held by mUndo and mRedo
+
+    void apply(const Step& step, SongDataFMS& sd, bool forward) const;
+    void trim();
+
+public:
+    // records the difference between before and after as one step,
+    // false if nothing changed. A new step drops the redo steps.
+    bool record(const SongDataFMS& before, const SongDataFMS& after, const char* label, bool coalesce = false);
+
+    // sd must be the song as recorded last
+    bool undo(SongDataFMS& sd);
+    bool redo(SongDataFMS& sd);
+
+    void clear();
+    // ends a typing burst, the next typing step starts a new one
+    void breakCoalescing() { if (!mUndo.empty()) mUndo.back().typing = false; }
+
+    bool canUndo() const { return !mUndo.empty(); }
+    bool canRedo() const { return !mRedo.empty(); }
+    const char* getUndoLabel() const { return mUndo.empty() ? "" : mUndo.back().label; }
+    const char* getRedoLabel() const { return mRedo.empty() ? "" : mRedo.back().label; }
+    size_t getUndoCount() const { return mUndo.size(); }
+    size_t getRedoCount() const { return mRedo.size(); }
+
+    size_t getMemoryBytes() const { return mBytes; }
+    size_t getBudget() const { return mBudget; }
+    void setBudget(size_t bytes) { mBudget = bytes; trim(); }
+};
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Logical channels (voices) of a multi chip OplController:
+//   voice = chip * channels per chip + channel
+// with 9 channels per chip, or 18 in OPL3 mode (both register banks).
+// Chip 0 holds the song channels, the voices behind them are handed out
+// to whoever needs one (sound effects, layers) with claim / release.
+//
+// The free voices are a FIFO: a released voice is reused last, so its
+// release phase can ring out. claim and release are O(1).
+// Not thread safe, use it from the thread which plays the notes (GUI).
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+
+class OplVoiceAllocator
+{
+public:
+    static constexpr uint32_t CHANNELS_PER_CHIP = 9;       // one register bank
+    static constexpr uint32_t MAX_CHANNELS_PER_CHIP = 18;  // OPL3 mode
+    static constexpr uint32_t MAX_CHIPS = 8;
+    static constexpr uint32_t MAX_VOICES = MAX_CHIPS * MAX_CHANNELS_PER_CHIP;
+
+    struct Voice {
+        uint8_t chip;
+        uint8_t channel;
+    };
+
+private:
+    uint8_t mFree[MAX_VOICES] = {};  // ring of free voices, oldest release first
+    uint32_t mFreeHead = 0;
+    uint32_t mFreeCount = 0;
+    uint32_t mChannelsPerChip = CHANNELS_PER_CHIP;
+    uint32_t mVoices = CHANNELS_PER_CHIP;
+    uint32_t mReserved = CHANNELS_PER_CHIP;
+    std::bitset<MAX_VOICES> mClaimed;
+
+    void pushFree(uint32_t voice)
+    {
+        mFree[(mFreeHead + mFreeCount) % MAX_VOICES] = (uint8_t)voice;
+        mFreeCount++;
+    }
+
+public:
+    OplVoiceAllocator() { configure(1, CHANNELS_PER_CHIP); }
+
+    // voices [0, channelsPerChip) of chip 0 are never handed out,
+    // all claims are dropped
+    void configure(uint32_t chips, uint32_t channelsPerChip)
+    {
+        chips = chips < 1 ? 1 : (chips > MAX_CHIPS ? MAX_CHIPS : chips);
+        mChannelsPerChip = channelsPerChip == MAX_CHANNELS_PER_CHIP ? MAX_CHANNELS_PER_CHIP : CHANNELS_PER_CHIP;
+        mVoices = chips * mChannelsPerChip;
+        mReserved = mChannelsPerChip;
+        mClaimed.reset();
+        mFreeHead = 0;
+        mFreeCount = 0;
+        for (uint32_t voice = mReserved; voice < mVoices; voice++)
+            pushFree(voice);
+    }
+
+    // a free voice, -1 if all are claimed
+    int claim()
+    {
+        if (mFreeCount == 0)
+            return -1;
+        const uint32_t voice = mFree[mFreeHead];
+        mFreeHead = (mFreeHead + 1) % MAX_VOICES;
+        mFreeCount--;
+        mClaimed[voice] = true;
+        return (int)voice;
+    }
+
+    // false if voice was not claimed
+    bool release(int voice)
+    {
+        if (voice < 0 || (uint32_t)voice >= mVoices || !mClaimed[voice])
+            return false;
+        mClaimed[voice] = false;
+        pushFree((uint32_t)voice);
+        return true;
+    }
+
+    Voice locate(uint32_t voice) const
+    {
+        return { (uint8_t)(voice / mChannelsPerChip), (uint8_t)(voice % mChannelsPerChip) };
+    }
+    uint32_t voiceOf(uint32_t chip, uint32_t channel) const
+    {
+        return chip * mChannelsPerChip + channel;
+    }
+
+    bool isClaimed(int voice) const { return voice >= 0 && (uint32_t)voice < mVoices && mClaimed[voice]; }
+    uint32_t getVoiceCount() const { return mVoices; }
+    uint32_t getChannelsPerChip() const { return mChannelsPerChip; }
+    uint32_t getReservedCount() const { return mReserved; }
+    uint32_t getFreeCount() const { return mFreeCount; }
+};
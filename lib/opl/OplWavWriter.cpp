@@ -0,0 +1,124 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+#include "OplWavWriter.h"
+#include "OplLog.h"
+
+#include <cerrno>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+bool OplWavWriter::open(const std::string& filename, const OplOutputSpec& spec)
+{
+    close();
+
+    mFile = std::fopen(filename.c_str(), "wb");
+    if (!mFile) {
+        Log("ERROR: Failed to open file for writing: %s", std::strerror(errno));
+        return false;
+    }
+    mSpec = spec;
+    mFrames = 0;
+    mFailed = false;
+
+    // sizes are patched in close
+    if (!writeHeader(0)) {
+        Log("ERROR: Failed to write wav header: %s", std::strerror(errno));
+        mFailed = true;
+    }
+    return !mFailed;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::writeU16LE(uint16_t value)
+{
+    const uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    return std::fwrite(bytes, 1, 2, mFile) == 2;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::writeU32LE(uint32_t value)
+{
+    const uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8),
+                               (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    return std::fwrite(bytes, 1, 4, mFile) == 4;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::writeTag(const char tag[4])
+{
+    return std::fwrite(tag, 1, 4, mFile) == 4;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::writeHeader(uint32_t dataSize)
+{
+    const bool lFloat = isFloat();
+    uint32_t numChannels = OplOutputSpec::CHANNELS;
+    uint32_t bitsPerSample = mSpec.bytesPerSample() * 8;
+    uint32_t byteRate = mSpec.rate * numChannels * (bitsPerSample / 8);
+    uint16_t blockAlign = (uint16_t)(numChannels * (bitsPerSample / 8));
+    uint32_t fileSize = headerSize() - 8 + dataSize;
+
+    bool ok = true;
+    ok &= writeTag("RIFF");
+    ok &= writeU32LE(fileSize);
+    ok &= writeTag("WAVE");
+    ok &= writeTag("fmt ");
+    ok &= writeU32LE(fmtSize());     // Subchunk1Size (16 for PCM)
+    ok &= writeU16LE(lFloat ? 3 : 1); // AudioFormat (1 for PCM, 3 for IEEE float)
+    ok &= writeU16LE((uint16_t)numChannels);
+    ok &= writeU32LE((uint32_t)mSpec.rate);
+    ok &= writeU32LE(byteRate);
+    ok &= writeU16LE(blockAlign);
+    ok &= writeU16LE((uint16_t)bitsPerSample);
+    if (lFloat) {
+        ok &= writeU16LE(0);           // cbSize
+        ok &= writeTag("fact");
+        ok &= writeU32LE(4);
+        ok &= writeU32LE(dataSize / mSpec.bytesPerFrame());
+    }
+    ok &= writeTag("data");
+    ok &= writeU32LE(dataSize);
+    return ok;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::write(const void* data, uint32_t frames)
+{
+    if (!mFile || mFailed)
+        return false;
+    if (frames == 0)
+        return true;
+
+    size_t bytes = (size_t)frames * mSpec.bytesPerFrame();
+    if (std::fwrite(data, 1, bytes, mFile) != bytes) {
+        Log("ERROR: Failed writing wav data: %s", std::strerror(errno));
+        mFailed = true;
+        return false;
+    }
+    mFrames += frames;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool OplWavWriter::close()
+{
+    if (!mFile)
+        return false;
+
+    bool ok = !mFailed;
+    uint64_t dataSize = mFrames * mSpec.bytesPerFrame();
+    if (dataSize + headerSize() > 0xFFFFFFFFull) {
+        Log("ERROR: wav data exceeds 4 GB, the header sizes are truncated");
+        dataSize = 0xFFFFFFFFull - headerSize();
+        ok = false;
+    }
+
+    // patch the sizes of what was written
+    if (std::fseek(mFile, 0, SEEK_SET) != 0 || !writeHeader((uint32_t)dataSize)) {
+        Log("ERROR: Failed to patch wav header: %s", std::strerror(errno));
+        ok = false;
+    }
+
+    if (std::fclose(mFile) != 0)
+        ok = false;
+    mFile = nullptr;
+    mFailed = !ok;
+    return ok;
+}
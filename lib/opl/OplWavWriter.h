@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// Streaming wav writer: the header is written with empty sizes on open,
+// chunks are appended and the RIFF / data (and fact) sizes are patched on
+// close. Memory use does not depend on the song length.
+// Plain stdio, the wav export does not need SDL.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "OplOutputSpec.h"
+
+class OplWavWriter
+{
+private:
+    std::FILE* mFile = nullptr;
+    OplOutputSpec mSpec;
+    uint64_t mFrames = 0;
+    bool mFailed = false;
+
+    static bool isFloat(const OplOutputSpec& spec) { return spec.format == OplOutputSpec::Format::F32; }
+    bool isFloat() const { return isFloat(mSpec); }
+    uint32_t fmtSize() const { return isFloat() ? 18 : 16; }
+    // header: 44 bytes for PCM, 58 for float (extended fmt + fact)
+    static uint32_t headerSize(const OplOutputSpec& spec) { return isFloat(spec) ? 58 : 44; }
+    uint32_t headerSize() const { return headerSize(mSpec); }
+    bool writeHeader(uint32_t dataSize);
+    bool writeU16LE(uint16_t value);
+    bool writeU32LE(uint32_t value);
+    bool writeTag(const char tag[4]);
+
+public:
+    OplWavWriter() = default;
+    ~OplWavWriter() { close(); }
+    OplWavWriter(const OplWavWriter&) = delete;
+    OplWavWriter& operator=(const OplWavWriter&) = delete;
+
+    bool open(const std::string& filename, const OplOutputSpec& spec);
+    // data holds frames interleaved stereo frames in the format of the spec
+    bool write(const void* data, uint32_t frames);
+    // patches the sizes, returns false if anything failed since open
+    bool close();
+
+    // the RIFF sizes are 32 bit: most frames a wav of the spec can hold
+    static uint64_t getMaxFrames(const OplOutputSpec& spec)
+    {
+        return (0xFFFFFFFFull - headerSize(spec)) / spec.bytesPerFrame();
+    }
+
+    bool isOpen() const { return mFile != nullptr; }
+    uint64_t getFrames() const { return mFrames; }
+};
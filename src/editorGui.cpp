@@ -40,6 +40,10 @@ bool EditorGui::Initialize()
     if (!mFMComposer->Initialize())
         return false;
 
+    mPerfWindow = new FluxPerfWindow( mFMEditor->getController());
+    if (!mPerfWindow->Initialize())
+        return false;
+
     // not centered ?!?!?! i guess center is not in place yet ?
     mBackground = new FluxRenderObject(getGame()->loadTexture("assets/fluxeditorback.png"));
     if (mBackground) {
@@ -49,7 +53,7 @@ bool EditorGui::Initialize()
     }
 
 
-    g_FileDialog.init( getGamePath(), {  ".sfx", ".fmi", ".fms", ".wav", ".ogg" });
+    g_FileDialog.init( getGamePath(), {  ".sfx", ".fmi", ".fms", ".fm3", ".wav", ".ogg", ".csv" });
 
     return true;
 }
@@ -57,6 +61,7 @@ bool EditorGui::Initialize()
 void EditorGui::Deinitialize()
 {
 
+    SAFE_DELETE(mPerfWindow);
     SAFE_DELETE(mFMComposer); //Composer before FMEditor !!!
     SAFE_DELETE(mFMEditor);
     SAFE_DELETE(mSfxEditor);
@@ -122,6 +127,8 @@ void EditorGui::ShowMenuBar()
             // ImGui::MenuItem("FM Full Scale", NULL, &mEditorSettings.mShowCompleteScale);
             ImGui::Separator();
             ImGui::MenuItem("Sound Effects Generator", NULL, &mEditorSettings.mShowSFXEditor);
+            ImGui::Separator();
+            ImGui::MenuItem("OPL Performance", NULL, &mEditorSettings.mShowPerformance);
 
             ImGui::EndMenu();
         }
@@ -187,6 +194,11 @@ void EditorGui::DrawGui()
     }
 
 
+    if (mEditorSettings.mShowPerformance) {
+        mPerfWindow->Draw(&mEditorSettings.mShowPerformance);
+    }
+
+
     DrawMsgBoxPopup();
 
 
@@ -199,7 +211,7 @@ void EditorGui::DrawGui()
         {
             if (!g_FileDialog.mCancelPressed)
             {
-                if (g_FileDialog.mSaveExt == ".fms")
+                if (g_FileDialog.mSaveExt == ".fms" || g_FileDialog.mSaveExt == ".fm3")
                 {
                     if (g_FileDialog.selectedExt == "")
                         g_FileDialog.selectedFile.append(g_FileDialog.mSaveExt);
@@ -219,6 +231,13 @@ void EditorGui::DrawGui()
                         g_FileDialog.selectedFile.append(g_FileDialog.mSaveExt);
                     mFMComposer->exportSongToWav(g_FileDialog.selectedFile);
                 }
+                else
+                if (g_FileDialog.mSaveExt == ".csv")
+                {
+                    if (g_FileDialog.selectedExt == "")
+                        g_FileDialog.selectedFile.append(g_FileDialog.mSaveExt);
+                    mPerfWindow->exportCsv(g_FileDialog.selectedFile);
+                }
 
             }
 
@@ -230,7 +249,7 @@ void EditorGui::DrawGui()
             if ( g_FileDialog.selectedExt == ".fmi" )
                 mFMEditor->loadInstrument(g_FileDialog.selectedFile);
             else
-            if ( g_FileDialog.selectedExt == ".fms" )
+            if ( g_FileDialog.selectedExt == ".fms" || g_FileDialog.selectedExt == ".fm3" )
                 mFMComposer->loadSong(g_FileDialog.selectedFile);
 
             //FIXME also load sfx here !!
@@ -282,6 +301,7 @@ void EditorGui::InitDockSpace()
     ImGui::DockBuilderDockWindow("FM Instrument Editor", dock_id_left);
     ImGui::DockBuilderDockWindow("Sound Effects Generator", dock_id_central);
     ImGui::DockBuilderDockWindow("FM Song Composer", dock_id_central);
+    ImGui::DockBuilderDockWindow("OPL Performance", dock_id_central);
 
 
     ImGui::DockBuilderFinish(dockspace_id);
@@ -5,6 +5,8 @@
 // TODO: to options:
 //              FluxEditorOplController => mSyncInstrumentChannel
 //              fileDialog => mDefaultPath
+// 2026-10-17
+// * OPL Performance window (audio callback timing, csv export)
 // 2026-01-10
 // * save your own settings file !! and ImGui ==> SaveIniSettingsToMemory
 //-----------------------------------------------------------------------------
@@ -20,6 +22,7 @@
 #include "fluxFMEditor.h"
 #include "fluxEditorGlobals.h"
 #include "fluxComposer.h"
+#include "fluxPerfWindow.h"
 
 
 
@@ -34,6 +37,7 @@ public:
         bool mShowFMInstrumentEditor;
         bool mShowFMComposer;
         bool mShowCompleteScale;
+        bool mShowPerformance;
         bool mEditorGuiInitialized;
     };
 
@@ -44,6 +48,7 @@ private:
     FluxSfxEditor* mSfxEditor = nullptr;
     FluxFMEditor* mFMEditor = nullptr;
     FluxComposer* mFMComposer = nullptr;
+    FluxPerfWindow* mPerfWindow = nullptr;
 
 
     EditorSettings mEditorSettings;
@@ -52,6 +57,7 @@ private:
         .mShowFMInstrumentEditor = true,
         .mShowFMComposer = true,
         .mShowCompleteScale = false,
+        .mShowPerformance = false,
         .mEditorGuiInitialized = false
     };
 
@@ -75,5 +81,6 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(EditorGui::EditorSettings,
     mShowFMInstrumentEditor,
     mShowFMComposer,
     mShowCompleteScale,
+    mShowPerformance,
     mEditorGuiInitialized
 )
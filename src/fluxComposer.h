@@ -32,6 +32,23 @@
 // * Save settings
 // * toggle melodic mode ++ save in settings
 //
+// 2026-10-17
+// * wav export renders on a private controller copy (cloneOffline),
+//   playback continues while exporting
+// * Sound rendering: Sinc (Hi-Fi)
+// * notes through getNote / setNote (pattern store), the cursor may move
+//   past row 1000
+// * play and export take a snapshot of the song, edits while playing are
+//   published to the sequencer once per frame
+// * undo / redo (Ctrl+z, Ctrl+y) with cell deltas (OplSongHistory), note
+//   typing and a slider drag / text field edit are merged into one step
+// * OPL3 songs load and save as .fm3, the grid still shows channels 1..9
+// * keyboard and piano play polyphonic (OplController::playLiveNote),
+//   a key up releases its note
+// * DrawNoteCell shows the static note name, no string per cell and frame
+// * Export asks for the wav rate and format (export spec, default 44100 Hz
+//   16 bit) instead of using the device format
+//
 // TODO Rythm Mode: different input per channel like a drum dings  !
 //     also need presets for channel 7 and 8 only have one for each
 // if (noteIndex == 35 || noteIndex == 36) {
@@ -68,22 +85,24 @@
 #include "imgui_internal.h"
 #include "fluxEditorOplController.h"
 #include "fluxEditorGlobals.h"
+#include <OplSongHistory.h>
 
 
 // ------------- Wav export in a thread >>>>>>>>>>>>>>
 struct ExportTask {
-    OplController* controller;
-    FluxEditorOplController::SongDataFMS song;
+    // private copy of the controller, the live one keeps playing
+    std::unique_ptr<OplController> engine;
+    FluxEditorOplController::SongSnapshot song; // shared with the editor, no copy
     std::string filename;
-    float progress = 0.0f; // Track progress here
-    bool isFinished = false;
+    std::atomic<float> progress = 0.0f; // written by the export thread, polled by the GUI
+    std::atomic<bool> isFinished = false;
 };
 
 // This is the function the thread actually runs
 static int SDLCALL ExportThreadFunc(void* data) {
     auto* task = static_cast<ExportTask*>(data);
 
-    task->controller->exportToWav(task->song, task->filename, &task->progress);
+    task->engine->renderToWav(task->song, task->filename, &task->progress);
 
     task->isFinished = true;
     return 0;
@@ -136,7 +155,17 @@ private:
 
     OplController::SongDataFMS mBufferSongData;
 
+    // immutable versions of mSongData: the last one built and the one the
+    // sequencer plays
+    OplController::SongSnapshot mSnapshot;
+    OplController::SongSnapshot mPlayingSnapshot;
+
+    // undo / redo, mUndoBase is the song as last recorded in mHistory
+    OplSongHistory mHistory;
+    OplController::SongSnapshot mUndoBase;
+
     ExportTask* mCurrentExport = nullptr; //<<< for export to wav
+    bool mOpenExportOptions = false;      // rate / format popup before the file dialog
 
 public:
 
@@ -166,7 +195,8 @@ public:
         {
             mController = new FluxEditorOplController();
             mItsMyController = true;
-            if (!mController || !mController->initController())
+            mController->setAudioOutput(std::make_unique<OplSdlOutput>());
+            if (!mController->initController())
                 return false;
         }
 
@@ -212,6 +242,7 @@ public:
 
         if (mController->loadSongFMS(filename, mSongData))
         {
+            resetHistory();
             resetSongSettings();
             mSongName = extractFilename(filename);
             return true;
@@ -233,6 +264,51 @@ public:
 
     bool  isPlaying() { return mController->getSequencerState().playing; }
     //-----------------------------------------------------------------------------------------------------
+    // snapshot of mSongData, rebuilt only after an edit. Cheap: the notes
+    // are shared until the next edit touches them
+    OplController::SongSnapshot getSnapshot()
+    {
+        if (!mSnapshot || !mSnapshot->isSameVersion(mSongData))
+            mSnapshot = OplController::makeSnapshot(mSongData);
+        return mSnapshot;
+    }
+    // records the edits since the last call as one undo step
+    void recordEdit(const char* lLabel, bool lTyping = false)
+    {
+        OplController::SongSnapshot lNow = getSnapshot();
+        if (mUndoBase && lNow != mUndoBase)
+            mHistory.record(*mUndoBase, mSongData, lLabel, lTyping);
+        mUndoBase = lNow;
+    }
+    void resetHistory()
+    {
+        mHistory.clear();
+        mUndoBase = getSnapshot();
+    }
+    void undo()
+    {
+        recordEdit("Edit");
+        if (mHistory.undo(mSongData))
+            mUndoBase = getSnapshot();
+    }
+    void redo()
+    {
+        recordEdit("Edit");
+        if (mHistory.redo(mSongData))
+            mUndoBase = getSnapshot();
+    }
+    // hands edits made while playing to the sequencer
+    void publishEdits()
+    {
+        if (!isPlaying())
+            return;
+        OplController::SongSnapshot lSnapshot = getSnapshot();
+        if (lSnapshot != mPlayingSnapshot) {
+            mPlayingSnapshot = lSnapshot;
+            mController->publishSong(lSnapshot);
+        }
+    }
+    //-----------------------------------------------------------------------------------------------------
     // when playing live adding !!
     void insertTone(const char* lName, int lOctaveAdd = 0)
     {
@@ -242,31 +318,44 @@ public:
         int lNewTone = mController->getNoteWithOctave(lChannel, lName, lOctaveAdd);
         if (isPlaying() && mLiveMode)
         {
-            mSongData.song[mCurrentPlayingRow][lChannel] = lNewTone;
+            mSongData.setNote(mCurrentPlayingRow, lChannel, lNewTone);
+            recordEdit("Typing", true);
         } else {
             if (std::strcmp(lName, "===") == 0)
             {
-                mSongData.song[mSelectedRow][lChannel] = -1;
-                mSelectedRow = std::min(FMS_MAX_SONG_LENGTH, mSelectedRow + mController->getStepByChannel(lChannel));
+                mSongData.setNote(mSelectedRow, lChannel, -1);
+                mSelectedRow = std::min(FMS_MAX_ROWS, mSelectedRow + mController->getStepByChannel(lChannel));
+                mController->stopLiveNotes();
                 mController->stopNote(lChannel);
+                recordEdit("Typing", true);
                 return ;
             }
             if (std::strcmp(lName, "...") == 0)
             {
-                mSongData.song[mSelectedRow][lChannel] = 0;
-                mSelectedRow = std::min(FMS_MAX_SONG_LENGTH, mSelectedRow + mController->getStepByChannel(lChannel));
+                mSongData.setNote(mSelectedRow, lChannel, 0);
+                mSelectedRow = std::min(FMS_MAX_ROWS, mSelectedRow + mController->getStepByChannel(lChannel));
+                mController->stopLiveNotes();
                 mController->stopNote(lChannel);
+                recordEdit("Typing", true);
                 return ;
             }
 
 
-            mSongData.song[mSelectedRow][lChannel] = lNewTone;
-            mController->playNoteDOS(lChannel, mSongData.song[mSelectedRow][lChannel]);
-            mSelectedRow = std::min(FMS_MAX_SONG_LENGTH, mSelectedRow + mController->getStepByChannel(lChannel));
+            mSongData.setNote(mSelectedRow, lChannel, lNewTone);
+            mController->playLiveNote(lChannel, mSongData.getNote(mSelectedRow, lChannel));
+            mSelectedRow = std::min(FMS_MAX_ROWS, mSelectedRow + mController->getStepByChannel(lChannel));
             if ( mSelectedRow > mSongData.song_length )
                 mSongData.song_length = mSelectedRow;
+            recordEdit("Typing", true);
         }
     }
+    //-----------------------------------------------------------------------------------------------------
+    // key up of a tone played by insertTone
+    void releaseTone(const char* lName, int lOctaveAdd = 0)
+    {
+        int lChannel = getCurrentChannel();
+        mController->stopLiveNote(lChannel, mController->getNoteWithOctave(lChannel, lName, lOctaveAdd));
+    }
     //--------------------------------------------------------------------------
     void DrawPianoScale()
     {
@@ -356,12 +445,12 @@ public:
                 if (mInsertMode)
                     insertTone(keys[i % 12].name, lOctaveAdd);
                 else {
-                    mController->playNoteDOS(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
+                    mController->playLiveNote(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
                 }
 
             }
             if (ImGui::IsItemDeactivated() && !mInsertMode)
-                mController->stopNote(lChannel);
+                mController->stopLiveNote(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
 
             if ((i % 12) == 0)
             {
@@ -402,12 +491,12 @@ public:
                 if (mInsertMode)
                     insertTone(keys[i % 12].name, lOctaveAdd);
                 else {
-                    mController->playNoteDOS(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
+                    mController->playLiveNote(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
                 }
 
             }
             if (ImGui::IsItemDeactivated() && !mInsertMode)
-                mController->stopNote(lChannel);
+                mController->stopLiveNote(lChannel, ((currentOctave - 1) * 12) + keys[i % 12].offset);
 
 
             if ((i % 12) == 0)
@@ -429,7 +518,7 @@ public:
     }
 
     //-----------------------------------------------------------------------------------------------------
-    void DrawNoteCell(int lRow, int lCol, int16_t& lNoteValue, FluxEditorOplController* lController, Color4F lNoteColor)
+    void DrawNoteCell(int lRow, int lCol, int16_t lNoteValue, FluxEditorOplController* lController, Color4F lNoteColor)
     {
         ImGui::TableSetColumnIndex(lCol);
         bool is_selected = (lRow == mSelectedRow && lCol == mSelectedCol);
@@ -465,9 +554,7 @@ public:
                 lDisplayText = "===";
                 lColor = ImColor4F(cl_Magenta);
             } else if (lNoteValue > 0) {
-                static std::string note_name;
-                note_name = lController->getNoteNameFromId(lNoteValue);
-                lDisplayText = note_name.c_str();
+                lDisplayText = lController->getNoteNameFromId(lNoteValue);
                 lColor = ImColor4F(lNoteColor);
             }
 
@@ -658,6 +745,54 @@ public:
 
     }
 
+    //-----------------------------------------------------------------------------------------------------
+    // the wav format is the one of the export, not the one of the device
+    void DrawExportOptions() {
+        if (mOpenExportOptions) {
+            ImGui::OpenPopup("Export Song (.wav)");
+            mOpenExportOptions = false;
+        }
+
+        ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+        if (ImGui::BeginPopupModal("Export Song (.wav)", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
+            static const int rates[] = { 22050, 44100, 48000, 96000 };
+            static const char* rateNames[] = { "22050 Hz", "44100 Hz", "48000 Hz", "96000 Hz" };
+            static const char* formatNames[] = { "16 bit", "32 bit float" };
+
+            OplOutputSpec lSpec = mController->getExportSpec();
+            int lRate = 1;
+            for (int i = 0; i < 4; i++)
+                if (rates[i] == lSpec.rate) lRate = i;
+            int lFormat = (lSpec.format == OplOutputSpec::Format::F32) ? 1 : 0;
+
+            ImGui::SetNextItemWidth(150);
+            if (ImGui::BeginCombo("Sample rate", rateNames[lRate])) {
+                for (int i = 0; i < 4; i++)
+                    if (ImGui::Selectable(rateNames[i], lRate == i)) lSpec.rate = rates[i];
+                ImGui::EndCombo();
+            }
+            ImGui::SetNextItemWidth(150);
+            if (ImGui::BeginCombo("Format", formatNames[lFormat])) {
+                for (int i = 0; i < 2; i++)
+                    if (ImGui::Selectable(formatNames[i], lFormat == i))
+                        lSpec.format = (i == 1) ? OplOutputSpec::Format::F32 : OplOutputSpec::Format::S16;
+                ImGui::EndCombo();
+            }
+            if (!(lSpec == mController->getExportSpec()))
+                mController->setExportSpec(lSpec);
+
+            ImGui::Separator();
+            if (ImGui::Button("Choose File", ImVec2(120, 0))) {
+                callExportFileDialog();
+                ImGui::CloseCurrentPopup();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel", ImVec2(120, 0)))
+                ImGui::CloseCurrentPopup();
+            ImGui::EndPopup();
+        }
+    }
+
     //-----------------------------------------------------------------------------------------------------
         void DrawExportStatus() {
         // Check if the thread task exists
@@ -700,8 +835,15 @@ public:
             return;
 
         // export to wav
+        DrawExportOptions();
         DrawExportStatus();
 
+        // edits without their own step (length, speed, ...). Held back while
+        // a widget is active: a slider drag or a text field is one step
+        if (!ImGui::IsAnyItemActive())
+            recordEdit("Edit");
+        publishEdits();
+
         auto handleNoteInput = [&](ImGuiKey key, const char* natural, const char* sharp) {
             if (ImGui::IsKeyPressed(key))
             {
@@ -749,6 +891,11 @@ public:
                 }
                 if (ImGui::BeginMenu("Edit"))
                 {
+                    std::string lUndoLabel = std::string("Undo ") + mHistory.getUndoLabel();
+                    std::string lRedoLabel = std::string("Redo ") + mHistory.getRedoLabel();
+                    if (ImGui::MenuItem(lUndoLabel.c_str(), "Ctrl+z", false, mHistory.canUndo())) { undo(); }
+                    if (ImGui::MenuItem(lRedoLabel.c_str(), "Ctrl+y", false, mHistory.canRedo())) { redo(); }
+                    ImGui::Separator();
                     if (ImGui::MenuItem("Insert emtpy row", "INS")) { insertEmpty(); }
                     ImGui::Separator();
                     if (ImGui::MenuItem("Copy", "Ctrl+c")) { copySelected(); }
@@ -807,6 +954,9 @@ public:
                     if (ImGui::MenuItem("Sound Blaster Clone", nullptr, currentMode == OplController::RenderMode::CLONE_CARD)) {
                         mController->setRenderMode(OplController::RenderMode::CLONE_CARD);
                     }
+                    if (ImGui::MenuItem("Sinc (Hi-Fi)", nullptr, currentMode == OplController::RenderMode::SINC)) {
+                        mController->setRenderMode(OplController::RenderMode::SINC);
+                    }
 
 
                     ImGui::EndMenu();
@@ -895,13 +1045,12 @@ public:
                     mIsEditing = true;
                     mJustOpenThisFrame = true; // SET THIS FLAG
 
-                    std::string current = mController->getNoteNameFromId(mSongData.song[mSelectedRow][mSelectedCol-1]);
-                    snprintf(mEditBuffer, sizeof(mEditBuffer), "%s", current.c_str());
+                    const char* current = mController->getNoteNameFromId(mSongData.getNote(mSelectedRow, mSelectedCol-1));
+                    snprintf(mEditBuffer, sizeof(mEditBuffer), "%s", current);
                 } else */{
 
 
                     int lChannel = getCurrentChannel();
-                    int16_t& current_note = mSongData.song[mSelectedRow][lChannel];
                     // Check for specific keys to "push" values immediately
 
                     // if (!mKeyboardMode)
@@ -920,7 +1069,8 @@ public:
 
                     // special without step
                     if (ImGui::IsKeyPressed(ImGuiKey_Space))  {
-                        current_note = -1; // "===" Note Off
+                        mSongData.setNote(mSelectedRow, lChannel, -1); // "===" Note Off
+                        recordEdit("Typing", true);
                     }
                     // else
                     if ( ImGui::IsKeyPressed(ImGuiKey_Delete))
@@ -932,7 +1082,10 @@ public:
                             if (mSelectionPivot >= 0)
                                 clearSelected();
                             else
-                                current_note = 0;  // "..." Empty
+                            {
+                                mSongData.setNote(mSelectedRow, lChannel, 0);  // "..." Empty
+                                recordEdit("Typing", true);
+                            }
                         }
 
                     }
@@ -971,6 +1124,15 @@ public:
                     {
                       pasteSelected();
                     }
+                    if (lCtrlPressed && ImGui::IsKeyPressed(ImGuiKey_Z))
+                    {
+                        if (lShiftPressed)
+                            redo();
+                        else
+                            undo();
+                    }
+                    if (lCtrlPressed && ImGui::IsKeyPressed(ImGuiKey_Y))
+                        redo();
                 }
             } //is_eding
 
@@ -1213,7 +1375,7 @@ public:
 
                             // Draw Channels
                             for (int col = 1; col <= 9; col++) {
-                                DrawNoteCell(row, col, mSongData.song[row][col-1], mController, lNoteColor);
+                                DrawNoteCell(row, col, mSongData.getNote(row, col-1), mController, lNoteColor);
                             }
 
                             ImGui::PopID();
@@ -1242,23 +1404,31 @@ public:
         mController->copySongRange(mSongData,getSelectionMin(), mBufferSongData, 0, getSelectionLen());
     }
     void pasteSelected(){
+        recordEdit("Edit");
         mController->copySongRange(mBufferSongData, 0, mSongData, getSelectionMin(), mBufferSongData.song_length);
+        recordEdit("Paste");
     }
     void clearSelected(){
+        recordEdit("Edit");
         mController->clearSongRange(mSongData,  getSelectionMin(), getSelectionMax());
+        recordEdit("Clear");
     }
 
     void deleteSelected() {
+        recordEdit("Edit");
         mController->deleteSongRange(mSongData,  getSelectionMin(), getSelectionMax());
+        recordEdit("Delete rows");
         resetSelection();
     }
     void insertEmpty() {
-        if ( (mSelectedRow == mSongData.song_length) && (mSongData.song_length <= FMS_MAX_SONG_LENGTH) ) {
+        recordEdit("Edit");
+        if ( (mSelectedRow == mSongData.song_length) && (mSongData.song_length < FMS_MAX_ROWS) ) {
             mSongData.song_length ++ ;
             mSelectedRow ++;
         } else {
             mController->insertRowAt(mSongData, mSelectedRow);
         }
+        recordEdit("Insert row");
     }
     void incOctave()
     {
@@ -1279,18 +1449,19 @@ public:
      */
     void playSong(U8 playMode = 0)
     {
+        mPlayingSnapshot = getSnapshot();
         switch (playMode)
         {
-            case 1: mController->playSong(mSongData, mLoop, getSelectionMin(), getSelectionMax() + 1);break;
-            case 2: mController->playSong(mSongData, mLoop); break;
+            case 1: mController->playSong(mPlayingSnapshot, mLoop, getSelectionMin(), getSelectionMax() + 1);break;
+            case 2: mController->playSong(mPlayingSnapshot, mLoop); break;
             case 3:
                 if (getSelectionLen() > 1)
                     playSong(1);
                 else
                     playSong(0);
                 break;
-            case 4: mController->playSong(mSongData, mLoop, mSelectedRow);break;
-            default: mController->playSong(mSongData, mLoop, mStartAt, mEndAt); break;
+            case 4: mController->playSong(mPlayingSnapshot, mLoop, mSelectedRow);break;
+            default: mController->playSong(mPlayingSnapshot, mLoop, mStartAt, mEndAt); break;
         }
     }
 
@@ -1389,22 +1560,30 @@ public:
               B-1 C   D   E   F   G   A   B   C+1
         */
 
-        if (/*mKeyboardMode && */!isAlt && !isCtrl && !isKeyUp)
+        // key down inserts / plays the tone, key up releases it
+        if (/*mKeyboardMode && */!isAlt && !isCtrl)
         {
-                 if (event.scancode == SDL_SCANCODE_Z)  insertTone("B-", -1);
-            else if (event.scancode == SDL_SCANCODE_X)  insertTone("C-",  0);
-            else if (event.scancode == SDL_SCANCODE_D)  insertTone("C#",  0);
-            else if (event.scancode == SDL_SCANCODE_C)  insertTone("D-",  0);
-            else if (event.scancode == SDL_SCANCODE_F)  insertTone("D#",  0);
-            else if (event.scancode == SDL_SCANCODE_V)  insertTone("E-",  0);
-            else if (event.scancode == SDL_SCANCODE_B)  insertTone("F-",  0);
-            else if (event.scancode == SDL_SCANCODE_H)  insertTone("F#",  0);
-            else if (event.scancode == SDL_SCANCODE_N)  insertTone("G-",  0);
-            else if (event.scancode == SDL_SCANCODE_J)  insertTone("G#",  0);
-            else if (event.scancode == SDL_SCANCODE_M)  insertTone("A-",  0);
-            else if (event.scancode == SDL_SCANCODE_K)  insertTone("A#",  0);
-            else if (event.scancode == SDL_SCANCODE_COMMA)  insertTone("B-",  0);
-            else if (event.scancode == SDL_SCANCODE_PERIOD)  insertTone("C-",  1);
+            auto tone = [&](const char* lName, int lOctaveAdd) {
+                if (isKeyUp)
+                    releaseTone(lName, lOctaveAdd);
+                else
+                    insertTone(lName, lOctaveAdd);
+            };
+
+                 if (event.scancode == SDL_SCANCODE_Z)  tone("B-", -1);
+            else if (event.scancode == SDL_SCANCODE_X)  tone("C-",  0);
+            else if (event.scancode == SDL_SCANCODE_D)  tone("C#",  0);
+            else if (event.scancode == SDL_SCANCODE_C)  tone("D-",  0);
+            else if (event.scancode == SDL_SCANCODE_F)  tone("D#",  0);
+            else if (event.scancode == SDL_SCANCODE_V)  tone("E-",  0);
+            else if (event.scancode == SDL_SCANCODE_B)  tone("F-",  0);
+            else if (event.scancode == SDL_SCANCODE_H)  tone("F#",  0);
+            else if (event.scancode == SDL_SCANCODE_N)  tone("G-",  0);
+            else if (event.scancode == SDL_SCANCODE_J)  tone("G#",  0);
+            else if (event.scancode == SDL_SCANCODE_M)  tone("A-",  0);
+            else if (event.scancode == SDL_SCANCODE_K)  tone("A#",  0);
+            else if (event.scancode == SDL_SCANCODE_COMMA)  tone("B-",  0);
+            else if (event.scancode == SDL_SCANCODE_PERIOD)  tone("C-",  1);
             // else if (event.scancode == SDL_SCANCODE_SPACE)  insertTone("===",  0);
 
 
@@ -1416,8 +1595,10 @@ public:
     void callSaveSong() {
         g_FileDialog.setFileName(mSongName);
         g_FileDialog.mSaveMode = true;
-        g_FileDialog.mSaveExt = ".fms";
-        g_FileDialog.mLabel = "Save Song (.fms)";
+        // OPL3 songs are saved as .fm3 (see OplController::saveSongFMS)
+        const bool opl3 = mController && mController->getOpl3Mode();
+        g_FileDialog.mSaveExt = opl3 ? ".fm3" : ".fms";
+        g_FileDialog.mLabel = opl3 ? "Save Song (.fm3)" : "Save Song (.fms)";
 
     }
 
@@ -1426,8 +1607,8 @@ public:
         if (mCurrentExport) return false; // Already exporting!
 
         mCurrentExport = new ExportTask();
-        mCurrentExport->controller = mController;
-        mCurrentExport->song = mSongData;
+        mCurrentExport->engine = mController->cloneOffline();
+        mCurrentExport->song = getSnapshot();
         mCurrentExport->filename = filename;
 
         // Create the thread
@@ -1450,7 +1631,12 @@ public:
     //     return mController->exportToWav(mSongData, filename );
     // }
 
+    // asks for the wav format first, see DrawExportOptions
     void callExportSong() {
+        mOpenExportOptions = true;
+    }
+
+    void callExportFileDialog() {
         g_FileDialog.setFileName(mSongName.append(".wav"));
         g_FileDialog.mSaveMode = true;
         g_FileDialog.mSaveExt = ".fms.wav";
@@ -1485,5 +1671,6 @@ public:
         if (resetInstruments)
             mController->loadInstrumentPresetSyncSongName(mSongData);
         mSongName = "newsong.fms";
+        resetHistory();
     }
 }; //class
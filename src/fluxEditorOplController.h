@@ -2,6 +2,12 @@
 // Copyright (c) 2026 Ohmtal Game Studio
 // SPDX-License-Identifier: MIT
 //-----------------------------------------------------------------------------
+// 2026-10-17
+// * cloneOffline also copies the channel settings (export keeps the mutes)
+// * the editor plays through OplSdlOutput, the engine has no SDL dependency
+// * row helpers use SongDataFMS::getNote / setNote, songs may be longer
+//   than 1000 rows (FMS_MAX_ROWS)
+// * channel settings and row helpers cover the 18 channels of OPL3 songs
 // 2026-01-08
 // * overrite void OplController::tickSequencer() to mute channels
 //-----------------------------------------------------------------------------
@@ -9,6 +15,7 @@
 #pragma once
 
 #include <OplController.h>
+#include <OplSdlOutput.h>
 
 static const int  OPL_MIN_OCTAVE = 1;
 static const int  OPL_MAX_OCTAVE = 8;
@@ -34,27 +41,27 @@ public:
         bool active = true;
     };
 
-    // Size is exactly the number of channels (e.g., 9)
-    ChannelSettings mChannelSettings[FMS_MAX_CHANNEL+1];
+    // Size is exactly the number of channels (e.g., 9, 18 in OPL3 mode)
+    ChannelSettings mChannelSettings[FMS_OPL3_CHANNELS];
     //--------------------------------------------------------------------------
 
     void setChannelActive( int channel , bool value )
     {
-         mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_MAX_CHANNEL)].active = value;
+         mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_OPL3_MAX_CHANNEL)].active = value;
          if (!value)
              stopNote(channel);
     }
 
     void setAllChannelActive( bool value )
     {
-        for ( int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++ )
+        for ( int ch = FMS_MIN_CHANNEL; ch < (int)getChipChannels(); ch++ )
             setChannelActive(ch, value);
     }
 
 
     bool getChannelActive( int channel  )
     {
-        if (channel < FMS_MIN_CHANNEL || channel > FMS_MAX_CHANNEL)
+        if (channel < FMS_MIN_CHANNEL || channel > FMS_OPL3_MAX_CHANNEL)
             return false;
         return mChannelSettings[channel].active;
     }
@@ -62,11 +69,11 @@ public:
     //--------------------------------------------------------------------------
     int getStepByChannel(int channel) {
 
-        return mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_MAX_CHANNEL)].step;
+        return mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_OPL3_MAX_CHANNEL)].step;
     }
     void setStepByChannel(int channel, int step) {
         step = std::clamp(step,0,99);
-        mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_MAX_CHANNEL)].step = step;
+        mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_OPL3_MAX_CHANNEL)].step = step;
     }
 
     void incStepByChannel(int channel ) {
@@ -83,11 +90,11 @@ public:
 
     //--------------------------------------------------------------------------
     int getOctaveByChannel(int channel) {
-        return mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_MAX_CHANNEL)].octave;
+        return mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_OPL3_MAX_CHANNEL)].octave;
     }
 
     void setOctaveByChannel(int channel, int val) {
-        mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_MAX_CHANNEL)].octave = std::clamp(val, OPL_MIN_OCTAVE, OPL_MAX_OCTAVE);
+        mChannelSettings[std::clamp(channel, FMS_MIN_CHANNEL, FMS_OPL3_MAX_CHANNEL)].octave = std::clamp(val, OPL_MIN_OCTAVE, OPL_MAX_OCTAVE);
     }
 
     void incOctaveByChannel(int channel)
@@ -119,21 +126,23 @@ public:
     // Insert Row Logic (Inside OplController)
     void insertRowAt(SongDataFMS& sd, uint16_t start)
     {
+        if (sd.song_length >= FMS_MAX_ROWS)
+            return;
 
         sd.song_length++;
 
         //  Move all rows below targetSeq down by one
         for (int i = sd.song_length; i > start; --i) {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL ; ++ch)
+            for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch)
             {
                 if (getChannelActive(ch))
-                    sd.song[i][ch] = sd.song[i-1][ch];
+                    sd.setNote(i, ch, sd.getNote(i - 1, ch));
             }
         }
         // Clear the newly inserted row
-        for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch){
+        for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch){
             if (getChannelActive(ch))
-                sd.song[start][ch] = 0;
+                sd.setNote(start, ch, 0);
         }
 
     }
@@ -144,30 +153,32 @@ public:
         int rangeLen = (end - start) + 1;
         // Shift data up
         for (int i = start; i < sd.song_length - rangeLen; ++i) {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch) {
+            for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch) {
                 if (getChannelActive(ch))
-                    sd.song[i][ch] = sd.song[i + rangeLen][ch];
+                    sd.setNote(i, ch, sd.getNote(i + rangeLen, ch));
             }
         }
         // Clear remaining rows at end
         for (int i = sd.song_length - rangeLen; i < sd.song_length; ++i) {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch)
+            for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch)
                 if (getChannelActive(ch))
-                    sd.song[i][ch] = 0;
+                    sd.setNote(i, ch, 0);
         }
         sd.song_length -= rangeLen;
     }
     //--------------------------------------------------------------------------
     bool clearSongRange(SongDataFMS& sd, uint16_t start, uint16_t end)
     {
-        if (end > FMS_MAX_SONG_LENGTH )
+        if (end > FMS_MAX_ROWS )
             return false;
 
-        for (int i = start; i <= end; ++i)
+        // rows past the allocated patterns are empty already
+        const int last = std::min<int>(end, (int)sd.notes.capacityRows() - 1);
+        for (int i = start; i <= last; ++i)
         {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch) {
+            for (int ch = FMS_MIN_CHANNEL; ch < sd.getChannelCount(); ++ch) {
                 if (getChannelActive(ch))
-                    sd.song[i][ch] = 0;
+                    sd.setNote(i, ch, 0);
             }
         }
         return true;
@@ -176,7 +187,7 @@ public:
     bool clearSong(SongDataFMS& sd)
     {
         sd.song_length = 0;
-        return clearSongRange(sd, 0,FMS_MAX_SONG_LENGTH);
+        return clearSongRange(sd, 0, FMS_MAX_ROWS);
     }
     //--------------------------------------------------------------------------
     bool copySongRange(SongDataFMS& fromSD, uint16_t fromStart,  SongDataFMS& toSD, uint16_t toStart, uint16_t len)
@@ -184,7 +195,7 @@ public:
 
         dLog("copySongRange len:%d", len );
 
-        if (fromStart + len > FMS_MAX_SONG_LENGTH + 1 || toStart + len > FMS_MAX_SONG_LENGTH + 1 )
+        if (fromStart + len > FMS_MAX_ROWS || toStart + len > FMS_MAX_ROWS )
         {
             Log("Cant copy SongData out of range! from %d, to %d", fromStart + len,toStart + len  );
             return false;
@@ -196,13 +207,24 @@ public:
 
         for ( int i = 0 ; i <= len; i++)
         {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ++ch)
+            for (int ch = FMS_MIN_CHANNEL; ch < toSD.getChannelCount(); ++ch)
                 if (getChannelActive(ch))
-                    toSD.song[i+toStart][ch] = fromSD.song[i+fromStart][ch];
+                    toSD.setNote(i + toStart, ch, fromSD.getNote(i + fromStart, ch));
         }
         return true;
     }
     //--------------------------------------------------------------------------
+    // offline copy for the export, with the channel settings so muted
+    // channels stay muted
+    std::unique_ptr<OplController> cloneOffline() const override
+    {
+        auto engine = std::make_unique<FluxEditorOplController>();
+        engine->copySoundState(*this);
+        std::copy(std::begin(mChannelSettings), std::end(mChannelSettings), engine->mChannelSettings);
+        engine->mSyncInstrumentChannel = mSyncInstrumentChannel;
+        return engine;
+    }
+    //--------------------------------------------------------------------------
     // override for only playing active channel
     void tickSequencer() override
     {
@@ -220,8 +242,10 @@ public:
         // if (mSeqState.song_counter < s.song_length)
         if (mSeqState.song_needle < mSeqState.song_stopAt)
         {
-            for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++) {
-                int16_t raw_note = s.song[mSeqState.song_needle][ch];
+            int16_t row[OplPatternStore::CHANNELS];
+            s.notes.getRow(mSeqState.song_needle, row);
+            for (int ch = FMS_MIN_CHANNEL; ch < s.getChannelCount(); ch++) {
+                int16_t raw_note = row[ch];
 
                 // Update UI/Debug state
                 mSeqState.last_notes[ch + 1] = raw_note;
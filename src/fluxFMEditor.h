@@ -43,7 +43,8 @@ public:
     bool Initialize() override
     {
         mController = new FluxEditorOplController();
-        if (!mController || !mController->initController())
+        mController->setAudioOutput(std::make_unique<OplSdlOutput>());
+        if (!mController->initController())
             return false;
 
         loadInstrumentPreset();
@@ -146,10 +147,10 @@ public:
                         ImGui::Button(label, ImVec2(-FLT_MIN, 0.0f));
 
                         if (ImGui::IsItemActivated()) {
-                            mController->playNoteDOS(getChannel(), noteIndex);
+                            mController->playLiveNote(getChannel(), noteIndex);
                         }
                         if (ImGui::IsItemDeactivated()) {
-                            mController->stopNote(getChannel());
+                            mController->stopLiveNote(getChannel(), noteIndex);
                         }
 
                         if (isSharp) ImGui::PopStyleColor();
@@ -161,6 +162,7 @@ public:
 
         ImGui::Separator();
         if (ImGui::Button("Stop Channel", ImVec2(-FLT_MIN, 0))) {
+            mController->stopLiveNotes();
             mController->stopNote(getChannel());
         }
 
@@ -217,8 +219,8 @@ public:
 
             ImGui::Button("##white", ImVec2(whiteWidth, whiteHeight));
 
-            if (ImGui::IsItemActivated()) mController->playNoteDOS(getChannel(), (currentOctave * 12) + keys[i].offset);
-            if (ImGui::IsItemDeactivated()) mController->stopNote(getChannel());
+            if (ImGui::IsItemActivated()) mController->playLiveNote(getChannel(), (currentOctave * 12) + keys[i].offset);
+            if (ImGui::IsItemDeactivated()) mController->stopLiveNote(getChannel(), (currentOctave * 12) + keys[i].offset);
 
             if (isNull) ImGui::EndDisabled();
             ImGui::PopID();
@@ -242,8 +244,8 @@ public:
 
             ImGui::Button("##black", ImVec2(blackWidth, blackHeight));
 
-            if (ImGui::IsItemActivated()) mController->playNoteDOS(getChannel(), (currentOctave * 12) + keys[i].offset);
-            if (ImGui::IsItemDeactivated()) mController->stopNote(getChannel());
+            if (ImGui::IsItemActivated()) mController->playLiveNote(getChannel(), (currentOctave * 12) + keys[i].offset);
+            if (ImGui::IsItemDeactivated()) mController->stopLiveNote(getChannel(), (currentOctave * 12) + keys[i].offset);
 
             if (isNull) ImGui::EndDisabled();
             ImGui::PopStyleColor(2);
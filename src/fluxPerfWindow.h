@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// OPL Performance window: timing of the audio callback (see OplRenderStats)
+// to tune SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES from data.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <core/fluxBaseObject.h>
+#include <imgui.h>
+#include "fluxEditorOplController.h"
+#include "fluxEditorGlobals.h"
+
+class FluxPerfWindow : public FluxBaseObject
+{
+private:
+    FluxEditorOplController* mController = nullptr;
+    OplRenderStats::Snapshot mStats;
+
+public:
+    FluxPerfWindow(FluxEditorOplController* lController) : mController(lController) {}
+
+    bool Initialize() override { return mController != nullptr; }
+    void Deinitialize() override {}
+
+    //--------------------------------------------------------------------------
+    bool exportCsv(const std::string& filename)
+    {
+        if (!mController)
+            return false;
+        if (!mController->getRenderStats().writeCsv(filename)) {
+            showMessage("Error", "Failed to write " + filename);
+            return false;
+        }
+        LogFMT("Performance stats saved to {}", filename);
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void Draw(bool* lOpen)
+    {
+        if (!mController)
+            return;
+
+        ImGui::SetNextWindowSizeConstraints(ImVec2(360.0f, 300.0f), ImVec2(FLT_MAX, FLT_MAX));
+        if (!ImGui::Begin("OPL Performance", lOpen, ImGuiWindowFlags_MenuBar)) {
+            ImGui::End();
+            return;
+        }
+
+        if (ImGui::BeginMenuBar())
+        {
+            if (ImGui::BeginMenu("File"))
+            {
+                if (ImGui::MenuItem("Export CSV")) {
+                    g_FileDialog.setFileName("opl_performance.csv");
+                    g_FileDialog.mSaveMode = true;
+                    g_FileDialog.mSaveExt = ".csv";
+                    g_FileDialog.mLabel = "Export Performance (.csv)";
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::MenuItem("Reset"))
+                mController->resetRenderStats();
+            ImGui::EndMenuBar();
+        }
+
+        mStats = mController->getRenderStats();
+        const double lLoad = mStats.lastLoad() * 100.0;
+
+        const char* lHint = SDL_GetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES);
+        ImGui::Text("Output: %d Hz, %s   SAMPLE_FRAMES hint: %s",
+                    mController->getOutputSpec().rate,
+                    mController->getOutputSpec().format == OplOutputSpec::Format::F32 ? "F32" : "S16",
+                    lHint ? lHint : "default");
+        ImGui::Separator();
+
+        if (ImGui::BeginTable("PerfStats", 2, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg))
+        {
+            auto row = [](const char* label, const char* fmt, auto... args) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(label);
+                ImGui::TableNextColumn();
+                ImGui::Text(fmt, args...);
+            };
+            row("Callbacks", "%llu", (unsigned long long)mStats.callbacks);
+            row("Buffer", "%u frames (max %u), %.2f ms", mStats.lastFrames, mStats.maxFrames, mStats.lastBufferUs / 1000.0);
+            row("Render", "%.1f us  avg %.1f  worst %.1f", mStats.lastRenderUs, mStats.avgRenderUs, mStats.worstRenderUs);
+            row("Load", "%.1f %%  worst %.1f %%", lLoad,
+                mStats.lastBufferUs > 0.0 ? mStats.worstRenderUs / mStats.lastBufferUs * 100.0 : 0.0);
+            row("Mutex wait", "%.2f us  worst %.2f", mStats.lastLockWaitUs, mStats.worstLockWaitUs);
+            row("Underruns", "%u  (locked: %u, too slow: %u)", mStats.underruns(), mStats.lockMisses, mStats.overruns);
+            row("Command queue", "%u  max %u  dropped %u", mStats.queueDepth, mStats.maxQueueDepth, mController->getCommandsDropped());
+            if (OplController::isCountingAudioThreadAllocations())
+                row("Audio thread allocations", "%llu", (unsigned long long)OplController::getAudioThreadAllocations());
+            else
+                row("Audio thread allocations", "%s", "not counted (OPL_COUNT_AUDIO_ALLOCATIONS)");
+            row("Chips", "%u  voices %u  free %u  %s", mController->getChipCount(), mController->getVoiceCount(),
+                mController->getVoices().getFreeCount(), mController->getParallelChips() ? "parallel" : "serial");
+            const uint64_t lIssued = mController->getRegWritesIssued();
+            const uint64_t lElided = mController->getRegWritesElided();
+            row("Register writes", "%llu  elided %llu (%.0f %%)", (unsigned long long)lIssued, (unsigned long long)lElided,
+                (lIssued + lElided) ? 100.0 * (double)lElided / (double)(lIssued + lElided) : 0.0);
+            ImGui::EndTable();
+        }
+
+        ImGui::Separator();
+        char lOverlay[32];
+        snprintf(lOverlay, sizeof(lOverlay), "load %.1f %%", lLoad);
+        ImGui::PlotLines("##LoadHistory", mStats.loadHistory, OplRenderStats::HISTORY, 0,
+                         lOverlay, 0.0f, 120.0f, ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+
+        float lHistogram[OplRenderStats::LOAD_BUCKETS];
+        for (uint32_t i = 0; i < OplRenderStats::LOAD_BUCKETS; i++)
+            lHistogram[i] = (float)mStats.loadHistogram[i];
+        ImGui::PlotHistogram("##LoadHistogram", lHistogram, OplRenderStats::LOAD_BUCKETS, 0,
+                             "load 0 .. 110%+ (10% steps)", 0.0f, FLT_MAX,
+                             ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+
+        ImGui::End();
+    }
+};
@@ -3,6 +3,12 @@
 //-----------------------------------------------------------------------------
 #include <SDL3/SDL_main.h> //<<< Android! and Windows
 #include "fluxEditorMain.h"
+
+#ifdef OPL_COUNT_AUDIO_ALLOCATIONS
+// counts the heap allocations of the audio thread, see the OPL Performance window
+#include "OplAudioAllocations.h"
+OPL_AUDIO_ALLOCATION_COUNTER
+#endif
 //------------------------------------------------------------------------------
 // Main
 //------------------------------------------------------------------------------
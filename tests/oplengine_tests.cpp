@@ -0,0 +1,510 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// oplengine_tests: ctest checks of the standalone OPL engine, links only
+// oplengine (no SDL, no OhmFlux).
+//
+//   oplengine_tests render <songdir>   headless render to a known frame count
+//   oplengine_tests wav                OplWavWriter header and size patching
+//   oplengine_tests fileio <songdir>   .fms / .fm3 load and save round trips
+//   oplengine_tests patterns           OplPatternStore copy on write
+//   oplengine_tests history            OplSongHistory steps, typing and budget
+//   oplengine_tests chips              extra chips: parallel equals serial, lockstep
+//
+// Returns 0 if every check passed.
+//-----------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OplController.h"
+#include "OplPatternStore.h"
+#include "OplSongHistory.h"
+#include "OplWavWriter.h"
+
+namespace fs = std::filesystem;
+
+static int sFailures = 0;
+
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            std::printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+            sFailures++; \
+        } \
+    } while (0)
+
+//------------------------------------------------------------------------------
+static std::vector<uint8_t> readFile(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+//------------------------------------------------------------------------------
+static uint16_t readU16LE(const std::vector<uint8_t>& data, size_t offset)
+{
+    if (offset + 2 > data.size())
+        return 0;
+    return (uint16_t)(data[offset] | (data[offset + 1] << 8));
+}
+//------------------------------------------------------------------------------
+static uint32_t readU32LE(const std::vector<uint8_t>& data, size_t offset)
+{
+    if (offset + 4 > data.size())
+        return 0;
+    return (uint32_t)data[offset] | ((uint32_t)data[offset + 1] << 8)
+         | ((uint32_t)data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+}
+//------------------------------------------------------------------------------
+static bool hasTag(const std::vector<uint8_t>& data, size_t offset, const char tag[4])
+{
+    return offset + 4 <= data.size() && std::memcmp(&data[offset], tag, 4) == 0;
+}
+//------------------------------------------------------------------------------
+static fs::path tempPath(const char* name)
+{
+    return fs::temp_directory_path() / (std::string("oplengine_tests_") + name);
+}
+//------------------------------------------------------------------------------
+// checks a written wav: header fields of the spec and sizes of frames
+static void checkWavFile(const fs::path& path, const OplOutputSpec& spec, uint64_t frames)
+{
+    const bool lFloat = spec.format == OplOutputSpec::Format::F32;
+    const size_t headerSize = lFloat ? 58 : 44;
+    const uint64_t dataSize = frames * spec.bytesPerFrame();
+    std::vector<uint8_t> data = readFile(path);
+
+    CHECK(data.size() == headerSize + dataSize);
+    CHECK(hasTag(data, 0, "RIFF"));
+    CHECK(readU32LE(data, 4) == data.size() - 8);
+    CHECK(hasTag(data, 8, "WAVE"));
+    CHECK(hasTag(data, 12, "fmt "));
+    CHECK(readU32LE(data, 16) == (lFloat ? 18u : 16u));
+    CHECK(readU16LE(data, 20) == (lFloat ? 3 : 1));
+    CHECK(readU16LE(data, 22) == OplOutputSpec::CHANNELS);
+    CHECK(readU32LE(data, 24) == (uint32_t)spec.rate);
+    CHECK(readU32LE(data, 28) == spec.rate * spec.bytesPerFrame());
+    CHECK(readU16LE(data, 32) == spec.bytesPerFrame());
+    CHECK(readU16LE(data, 34) == spec.bytesPerSample() * 8);
+    if (lFloat) {
+        CHECK(readU16LE(data, 36) == 0);
+        CHECK(hasTag(data, 38, "fact"));
+        CHECK(readU32LE(data, 42) == 4);
+        CHECK(readU32LE(data, 46) == frames);
+    }
+    CHECK(hasTag(data, headerSize - 8, "data"));
+    CHECK(readU32LE(data, headerSize - 4) == dataSize);
+}
+
+//------------------------------------------------------------------------------
+// SONG09.FMS: delay 15, 81 rows, one tick per row.
+// samples_per_tick = rate / (90 / 15): 7350 at 44100, 8000 at 48000
+static void testRender(const fs::path& songDir)
+{
+    const fs::path song = songDir / "SONG09.FMS";
+    const struct {
+        OplOutputSpec spec;
+        uint64_t frames;
+        const char* file;
+    } cases[] = {
+        { { 44100, OplOutputSpec::Format::S16 }, 81ull * 7350, "render_s16.wav" },
+        { { 48000, OplOutputSpec::Format::F32 }, 81ull * 8000, "render_f32.wav" },
+    };
+
+    for (const auto& c : cases) {
+        auto controller = std::make_unique<OplController>();
+        auto sd = std::make_unique<OplController::SongDataFMS>();
+        CHECK(controller->setOutputSpec(c.spec));
+        if (!controller->loadSongFMS(song.string(), *sd)) {
+            std::printf("FAIL cannot load %s\n", song.string().c_str());
+            sFailures++;
+            return;
+        }
+        CHECK(sd->song_delay == 15);
+        CHECK(sd->song_length == 81);
+
+        const fs::path out = tempPath(c.file);
+        std::atomic<float> progress = 0.f;
+        CHECK(controller->renderToWav(*sd, out.string(), &progress));
+        CHECK(controller->getRenderedFrames() == c.frames);
+        CHECK(progress.load() == 1.f);
+        checkWavFile(out, c.spec, c.frames);
+
+        // a song plays something
+        std::vector<uint8_t> data = readFile(out);
+        CHECK(std::any_of(data.begin() + 64, data.end(), [](uint8_t b) { return b != 0; }));
+        fs::remove(out);
+    }
+
+    // 65535 rows at delay 255 exceed the 4 GB of a wav, rejected before
+    // anything is written
+    auto controller = std::make_unique<OplController>();
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    sd->init();
+    sd->song_delay = 255;
+    sd->song_length = 65535;
+    const fs::path out = tempPath("render_long.wav");
+    fs::remove(out);
+    CHECK(!controller->renderToWav(*sd, out.string()));
+    CHECK(!fs::exists(out));
+    CHECK(controller->getRenderedFrames() == 0);
+}
+
+//------------------------------------------------------------------------------
+static void testWav()
+{
+    for (OplOutputSpec::Format format : { OplOutputSpec::Format::S16, OplOutputSpec::Format::F32 }) {
+        const OplOutputSpec spec { 22050, format };
+        const fs::path out = tempPath(format == OplOutputSpec::Format::F32 ? "wav_f32.wav" : "wav_s16.wav");
+
+        // empty file: header only, sizes patched to 0 frames
+        {
+            OplWavWriter writer;
+            CHECK(writer.open(out.string(), spec));
+            CHECK(writer.isOpen());
+            CHECK(writer.write(nullptr, 0));
+            CHECK(writer.close());
+            CHECK(!writer.isOpen());
+            checkWavFile(out, spec, 0);
+        }
+
+        // chunks of different length, the sizes add up
+        {
+            std::vector<uint8_t> chunk(1000 * spec.bytesPerFrame());
+            for (size_t i = 0; i < chunk.size(); i++)
+                chunk[i] = (uint8_t)(i * 7);
+            OplWavWriter writer;
+            CHECK(writer.open(out.string(), spec));
+            CHECK(writer.write(chunk.data(), 1000));
+            CHECK(writer.write(chunk.data(), 1));
+            CHECK(writer.write(chunk.data(), 333));
+            CHECK(writer.getFrames() == 1334);
+            CHECK(writer.close());
+            checkWavFile(out, spec, 1334);
+
+            // the data follows the header unchanged
+            std::vector<uint8_t> data = readFile(out);
+            const size_t headerSize = (format == OplOutputSpec::Format::F32) ? 58 : 44;
+            CHECK(data.size() > headerSize + chunk.size());
+            CHECK(std::equal(chunk.begin(), chunk.end(), data.begin() + headerSize));
+        }
+
+        // closed twice / written after close
+        {
+            OplWavWriter writer;
+            CHECK(writer.open(out.string(), spec));
+            CHECK(writer.close());
+            CHECK(!writer.close());
+            uint8_t frame[8] = {};
+            CHECK(!writer.write(frame, 1));
+        }
+        fs::remove(out);
+    }
+
+    OplWavWriter writer;
+    CHECK(!writer.open((tempPath("missing") / "dir" / "x.wav").string(), OplOutputSpec()));
+}
+
+//------------------------------------------------------------------------------
+static void testFileIO(const fs::path& songDir)
+{
+    // every bundled .fms: load -> save is byte identical
+    int songs = 0;
+    std::error_code ec;
+    const fs::path saved = tempPath("roundtrip.fms");
+    for (const auto& entry : fs::directory_iterator(songDir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (!entry.is_regular_file() || ext != ".fms")
+            continue;
+
+        std::vector<uint8_t> original = readFile(entry.path());
+        auto controller = std::make_unique<OplController>();
+        auto sd = std::make_unique<OplController::SongDataFMS>();
+        if (!controller->loadSongFMS(entry.path().string(), *sd)) {
+            std::printf("FAIL cannot load %s\n", entry.path().string().c_str());
+            sFailures++;
+            continue;
+        }
+        songs++;
+        CHECK(controller->saveSongFMS(saved.string(), *sd));
+        if (readFile(saved) != original) {
+            std::printf("FAIL %s: saved song differs\n", entry.path().filename().string().c_str());
+            sFailures++;
+        }
+
+        // and loads back to the same song
+        auto reloaded = std::make_unique<OplController::SongDataFMS>();
+        CHECK(controller->loadSongFMS(saved.string(), *reloaded));
+        CHECK(reloaded->song_delay == sd->song_delay);
+        CHECK(reloaded->song_length == sd->song_length);
+
+        // the static codec gives the same bytes
+        std::vector<uint8_t> encoded;
+        OplController::encodeSongFMS(*sd, encoded);
+        CHECK(encoded == original);
+
+        // truncated images are rejected, sd is kept
+        auto decoded = std::make_unique<OplController::SongDataFMS>();
+        CHECK(!OplController::decodeSongFMS(original.data(), original.size() - 1, *decoded, "truncated"));
+        CHECK(!OplController::decodeSongFMS(original.data(), OplController::FMS_HEADER_BYTES - 1, *decoded, "truncated"));
+        CHECK(decoded->song_length == 0);
+    }
+    fs::remove(saved);
+    CHECK(songs > 0);
+
+    // .fm3: 18 channels, 4-op mask, notes and names survive save / load
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    sd->init();
+    sd->opl3 = true;
+    sd->four_op = 0x09;
+    sd->song_length = 70;
+    CHECK(sd->setNote(5, 15, 33));
+    CHECK(sd->setNote(65, 17, -1));
+    CHECK(sd->setNote(0, 0, 40));
+    sd->setInstrumentName(16, "bank1");
+
+    std::vector<uint8_t> encoded;
+    OplController::encodeSongFM3(*sd, encoded);
+    CHECK(encoded.size() == OplController::FM3_HEADER_BYTES + 70 * FMS_OPL3_CHANNELS * 2);
+    CHECK(OplController::isSongFM3(encoded.data(), encoded.size()));
+
+    auto decoded = std::make_unique<OplController::SongDataFMS>();
+    CHECK(OplController::decodeSongFM3(encoded.data(), encoded.size(), *decoded));
+    CHECK(decoded->opl3);
+    CHECK(decoded->four_op == 0x09);
+    CHECK(decoded->song_length == 70);
+    CHECK(decoded->getNote(5, 15) == 33);
+    CHECK(decoded->getNote(65, 17) == -1);
+    CHECK(decoded->getNote(0, 0) == 40);
+    CHECK(decoded->getInstrumentName(16) == "bank1");
+
+    std::vector<uint8_t> reencoded;
+    OplController::encodeSongFM3(*decoded, reencoded);
+    CHECK(reencoded == encoded);
+
+    auto rejected = std::make_unique<OplController::SongDataFMS>();
+    CHECK(!OplController::decodeSongFM3(encoded.data(), encoded.size() - 1, *rejected));
+    encoded[4] = OplController::FM3_VERSION + 1;
+    CHECK(!OplController::decodeSongFM3(encoded.data(), encoded.size(), *rejected));
+}
+
+//------------------------------------------------------------------------------
+// a write never reaches a pattern another store (a snapshot) still holds
+static void testPatterns()
+{
+    OplPatternStore store;
+    CHECK(store.set(3, 2, 40));
+    const OplPatternStore::Pattern* first = store.getOrder()[0].get();
+
+    // owned: written in place
+    CHECK(store.set(4, 2, 41));
+    CHECK(store.getOrder()[0].get() == first);
+
+    // a copy shares the pattern, the next write of either side unshares it
+    OplPatternStore snapshot = store;
+    CHECK(snapshot.getOrder()[0].get() == first);
+    CHECK(store.set(3, 2, 50));
+    CHECK(store.getOrder()[0].get() != first);
+    CHECK(snapshot.get(3, 2) == 40);
+    CHECK(store.get(3, 2) == 50);
+
+    // still shared after the copy is gone: the tag, not the use count decides
+    const OplPatternStore::Pattern* second = store.getOrder()[0].get();
+    {
+        OplPatternStore dropped = store;
+    }
+    CHECK(store.set(5, 2, 42));
+    const OplPatternStore::Pattern* third = store.getOrder()[0].get();
+    CHECK(third != second);
+    CHECK(store.set(6, 2, 43));
+    CHECK(store.getOrder()[0].get() == third);
+
+    OplPatternStore copy = snapshot;
+    CHECK(snapshot.set(3, 2, 60));
+    CHECK(copy.get(3, 2) == 40);
+    CHECK(snapshot.get(3, 2) == 60);
+
+    // identical patterns of an imported grid share one allocation, a write
+    // to one slot leaves the others alone
+    const uint32_t rows = OplPatternStore::PATTERN_ROWS * 3;
+    std::vector<int16_t> grid(rows * 9);
+    for (uint32_t row = 0; row < rows; row++)
+        grid[row * 9 + 1] = (int16_t)(row % OplPatternStore::PATTERN_ROWS + 1);
+    OplPatternStore imported;
+    CHECK(imported.importRows(grid.data(), rows, 9));
+    CHECK(imported.getPatternCount() == 1);
+    CHECK(imported.set(OplPatternStore::PATTERN_ROWS + 2, 1, -1));
+    CHECK(imported.getPatternCount() == 2);
+    CHECK(imported.get(2, 1) == 3);
+    CHECK(imported.get(OplPatternStore::PATTERN_ROWS + 2, 1) == -1);
+    CHECK(imported.get(OplPatternStore::PATTERN_ROWS * 2 + 2, 1) == 3);
+
+    // moving keeps the ownership
+    OplPatternStore moved = std::move(imported);
+    const OplPatternStore::Pattern* own = moved.getOrder()[1].get();
+    CHECK(moved.set(OplPatternStore::PATTERN_ROWS + 3, 1, -1));
+    CHECK(moved.getOrder()[1].get() == own);
+}
+
+//------------------------------------------------------------------------------
+static void testHistory()
+{
+    using SongDataFMS = OplController::SongDataFMS;
+    auto song = std::make_unique<SongDataFMS>();
+    song->init();
+    song->song_length = 512;
+    const SongDataFMS original = *song;
+
+    OplSongHistory history;
+    OplController::SongSnapshot base = OplController::makeSnapshot(*song);
+    auto record = [&](const char* label, bool typing) {
+        bool changed = history.record(*base, *song, label, typing);
+        base = OplController::makeSnapshot(*song);
+        return changed;
+    };
+
+    // a typing burst is one step, the same cell typed twice keeps its
+    // first before value
+    for (int i = 0; i < 300; i++) {
+        CHECK(song->setNote((i * 37) % 512, i % 9, (int16_t)(1 + i % 80)));
+        CHECK(record("Typing", true));
+    }
+    CHECK(song->setNote(0, 0, 7));
+    CHECK(record("Typing", true));
+    CHECK(history.getUndoCount() == 1);
+    const SongDataFMS typed = *song;
+
+    CHECK(song->setNote(1, 1, 9));
+    CHECK(record("Edit", false));
+    CHECK(!record("Edit", false));
+    CHECK(history.getUndoCount() == 2);
+
+    CHECK(history.undo(*song));
+    CHECK(song->notes.getRevision() != typed.notes.getRevision());
+    CHECK(song->getNote(1, 1) == 0);
+    CHECK(history.undo(*song));
+    for (int i = 0; i < 300; i++)
+        CHECK(song->getNote((i * 37) % 512, i % 9) == original.getNote((i * 37) % 512, i % 9));
+    CHECK(!history.undo(*song));
+    CHECK(history.redo(*song));
+    CHECK(song->getNote(0, 0) == 7);
+    CHECK(song->getNote(37, 1) == typed.getNote(37, 1));
+    base = OplController::makeSnapshot(*song);
+
+    // typed back to the start of a burst: no step is left
+    history.clear();
+    CHECK(song->setNote(2, 2, 5));
+    CHECK(record("Typing", true));
+    CHECK(song->setNote(2, 2, 0));
+    CHECK(record("Typing", true));
+    CHECK(history.getUndoCount() == 0);
+    CHECK(history.getMemoryBytes() == 0);
+
+    // a typing burst stays within the budget
+    history.clear();
+    history.setBudget(4 * 1024);
+    for (int i = 0; i < 2000; i++) {
+        CHECK(song->setNote(i % 512, (i / 512) % 9, (int16_t)(100 + i % 50)));
+        CHECK(record("Typing", true));
+        CHECK(history.getMemoryBytes() <= history.getBudget() + 512);
+    }
+    CHECK(history.canUndo());
+}
+
+//------------------------------------------------------------------------------
+static std::vector<int16_t> renderBlocks(OplController& controller, int blocks, int frames)
+{
+    std::vector<int16_t> out;
+    std::vector<int16_t> block((size_t)frames * 2);
+    for (int i = 0; i < blocks; i++) {
+        controller.fillBuffer(block.data(), frames);
+        out.insert(out.end(), block.begin(), block.end());
+    }
+    return out;
+}
+
+static void testChips()
+{
+    auto makeController = [](bool parallel) {
+        auto controller = std::make_unique<OplController>();
+        controller->reset();
+        CHECK(controller->setChipCount(3));
+        controller->setParallelChips(parallel);
+        auto ins = controller->GetMelodicDefault(0);
+        for (int voice : { 9, 12, 20 })
+            controller->setInstrument(voice, ins.data());
+        return controller;
+    };
+
+    // the workers (or the render thread taking their chips over) give the
+    // serial result, block sizes above and below OPL_PARALLEL_MIN_SAMPLES
+    auto serial = makeController(false);
+    auto parallel = makeController(true);
+    std::vector<int16_t> rendered[2];
+    int k = 0;
+    for (OplController* controller : { serial.get(), parallel.get() }) {
+        controller->playNoteDOS(20, 40);
+        controller->playNoteDOS(12, 30);
+        rendered[k] = renderBlocks(*controller, 20, 1024);
+        controller->stopNote(12);
+        controller->playNoteDOS(9, 45);
+        std::vector<int16_t> small = renderBlocks(*controller, 200, 37);
+        rendered[k].insert(rendered[k].end(), small.begin(), small.end());
+        k++;
+    }
+    CHECK(rendered[0] == rendered[1]);
+    CHECK(std::any_of(rendered[0].begin(), rendered[0].end(), [](int16_t v) { return v != 0; }));
+
+    // stopNote does not clock an extra chip ahead of the others: a key off
+    // of a silent channel leaves the note playing on that chip unchanged
+    auto plain = makeController(true);
+    auto stopped = makeController(true);
+    plain->playNoteDOS(9, 40);
+    stopped->playNoteDOS(9, 40);
+    renderBlocks(*plain, 4, 512);
+    renderBlocks(*stopped, 4, 512);
+    for (int i = 0; i < 5; i++)
+        stopped->stopNote(10);
+    CHECK(renderBlocks(*plain, 20, 512) == renderBlocks(*stopped, 20, 512));
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: oplengine_tests render|wav|fileio|patterns|history|chips [songdir]\n");
+        return 2;
+    }
+    gOplLogQuiet = true;
+
+    const std::string test = argv[1];
+    const fs::path songDir = (argc > 2) ? argv[2] : "pascal/ADLIB";
+    if (test == "render")
+        testRender(songDir);
+    else if (test == "wav")
+        testWav();
+    else if (test == "fileio")
+        testFileIO(songDir);
+    else if (test == "patterns")
+        testPatterns();
+    else if (test == "history")
+        testHistory();
+    else if (test == "chips")
+        testChips();
+    else {
+        std::fprintf(stderr, "unknown test: %s\n", test.c_str());
+        return 2;
+    }
+
+    std::printf("%s: %s (%d failures)\n", test.c_str(), sFailures ? "FAILED" : "OK", sFailures);
+    return sFailures ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// fmsbench: microbenchmarks of the OPL engine hot paths.
+//
+//   render/<mode>       fillBuffer per RenderMode (S16, 512 frame blocks)
+//   render_f32/<mode>   the same in F32
+//   chips/<n>[_serial]  the song on chip 0 and a held note on every voice
+//                       of n - 1 extra chips, parallel and serial render
+//   sequencer/dense     tickSequencer on a song with a note on all 9
+//                       channels in every row
+//   instrument/set      setInstrument register programming
+//   file/load, save     loadSongFMS / saveSongFMS
+//   notes/frame         the note names of one tracker frame as DrawNoteCell
+//                       shows them, 64 rows x 9 channels full of notes
+//   notes/parse         getIdFromNoteName of every note name
+//   export/<song>       exportToWav of every song in the song directory
+//
+// Per benchmark: ns per operation, ns per sample frame and the real-time
+// factor where audio is produced, heap allocations per operation.
+// --json / --csv keep the results for comparing releases.
+//
+//   fmsbench --songs pascal/ADLIB --json bench.json
+//-----------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OplController.h"
+
+namespace fs = std::filesystem;
+
+//------------------------------------------------------------------------------
+// heap allocation counter of the whole process (getTotalCount), also feeds
+// the audio thread count of the engine
+OPL_AUDIO_ALLOCATION_COUNTER
+
+//------------------------------------------------------------------------------
+static int64_t benchNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;        // mean
+    double nsPerOpBest = 0.0;
+    double nsPerSample = 0.0;    // 0 if no audio is produced
+    double realtimeFactor = 0.0; // audio seconds per wall second, 0 if no audio
+    double allocsPerOp = 0.0;
+};
+
+struct BenchOptions {
+    std::string songDir = "pascal/ADLIB";
+    std::string jsonFile;
+    std::string csvFile;
+    std::string filter;       // substring of the benchmark name
+    double minTime = 0.25;    // seconds per benchmark
+    bool exportSongs = true;
+};
+
+//------------------------------------------------------------------------------
+// runs op until minTime is spent, framesPerOp / rate describe the audio one
+// op produces (0 for none)
+static BenchResult runBench(const std::string& name, const BenchOptions& opt,
+                            const std::function<void()>& op,
+                            uint64_t framesPerOp = 0, int rate = OplOutputSpec::DEFAULT_RATE)
+{
+    BenchResult result;
+    result.name = name;
+
+    op(); // warm up, first touch allocations are not counted
+
+    const int64_t budget = (int64_t)(opt.minTime * 1e9);
+    const uint64_t allocStart = OplAudioAllocations::getTotalCount();
+    int64_t total = 0;
+    int64_t best = INT64_MAX;
+    while (total < budget || result.iterations < 3) {
+        const int64_t start = benchNowNs();
+        op();
+        const int64_t elapsed = benchNowNs() - start;
+        total += elapsed;
+        best = std::min(best, elapsed);
+        result.iterations++;
+    }
+
+    result.nsPerOp = (double)total / (double)result.iterations;
+    result.nsPerOpBest = (double)best;
+    result.allocsPerOp = (double)(OplAudioAllocations::getTotalCount() - allocStart) / (double)result.iterations;
+    if (framesPerOp > 0) {
+        result.nsPerSample = result.nsPerOp / (double)framesPerOp;
+        result.realtimeFactor = ((double)framesPerOp / (double)rate) / (result.nsPerOp / 1e9);
+    }
+    return result;
+}
+//------------------------------------------------------------------------------
+static std::vector<fs::path> findSongs(const std::string& dir)
+{
+    std::vector<fs::path> songs;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (entry.is_regular_file() && ext == ".fms")
+            songs.push_back(entry.path());
+    }
+    std::sort(songs.begin(), songs.end());
+    return songs;
+}
+//------------------------------------------------------------------------------
+// every row plays a note on every channel, the worst case for tickSequencer
+static void buildDenseSong(OplController::SongDataFMS& sd)
+{
+    sd.init();
+    sd.song_delay = 1;
+    sd.song_length = FMS_MAX_SONG_LENGTH;
+    for (int row = 0; row < FMS_MAX_SONG_LENGTH; row++)
+        for (int ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++)
+            sd.setNote(row, ch, (int16_t)(1 + (row * 7 + ch * 5) % 84));
+}
+
+static const struct {
+    const char* name;
+    OplController::RenderMode mode;
+} sModes[] = {
+    { "raw",       OplController::RenderMode::RAW },
+    { "blended",   OplController::RenderMode::BLENDED },
+    { "modernlpf", OplController::RenderMode::MODERN_LPF },
+    { "sbpro",     OplController::RenderMode::SBPRO },
+    { "sb",        OplController::RenderMode::SB_ORIGINAL },
+    { "adlibgold", OplController::RenderMode::ADLIB_GOLD },
+    { "clone",     OplController::RenderMode::CLONE_CARD },
+    { "sinc",      OplController::RenderMode::SINC },
+};
+
+//------------------------------------------------------------------------------
+static void benchRender(const BenchOptions& opt, const fs::path& songFile,
+                        std::vector<BenchResult>& results)
+{
+    const int blockFrames = 512;
+    const int blocksPerOp = 64;
+
+    for (int pass = 0; pass < 2; pass++) {
+        const bool f32 = (pass == 1);
+        for (const auto& mode : sModes) {
+            std::string name = std::string(f32 ? "render_f32/" : "render/") + mode.name;
+            if (name.find(opt.filter) == std::string::npos)
+                continue;
+
+            auto controller = std::make_unique<OplController>();
+            auto sd = std::make_unique<OplController::SongDataFMS>();
+            sd->init();
+            if (!controller->loadSongFMS(songFile.string(), *sd))
+                return;
+            controller->setRenderMode(mode.mode);
+            controller->start_song(*sd, true);
+
+            std::vector<int16_t> s16((size_t)blockFrames * 2);
+            std::vector<float> fl((size_t)blockFrames * 2);
+            results.push_back(runBench(name, opt, [&]() {
+                for (int i = 0; i < blocksPerOp; i++) {
+                    if (f32)
+                        controller->fillBuffer(fl.data(), blockFrames);
+                    else
+                        controller->fillBuffer(s16.data(), blockFrames);
+                }
+            }, (uint64_t)blockFrames * blocksPerOp));
+        }
+    }
+}
+//------------------------------------------------------------------------------
+static void benchChips(const BenchOptions& opt, const fs::path& songFile,
+                       std::vector<BenchResult>& results)
+{
+    const int blockFrames = 512;
+    const int blocksPerOp = 64;
+
+    for (uint32_t chips : { 1u, 2u, 4u, 8u }) {
+        for (int pass = 0; pass < 2; pass++) {
+            const bool serial = (pass == 1);
+            if (serial && chips == 1)
+                continue;
+            std::string name = "chips/" + std::to_string(chips) + (serial ? "_serial" : "");
+            if (name.find(opt.filter) == std::string::npos)
+                continue;
+
+            auto controller = std::make_unique<OplController>();
+            auto sd = std::make_unique<OplController::SongDataFMS>();
+            sd->init();
+            if (!controller->loadSongFMS(songFile.string(), *sd))
+                return;
+            controller->setChipCount(chips);
+            controller->setParallelChips(!serial);
+            for (int voice = controller->claimVoice(); voice >= 0; voice = controller->claimVoice()) {
+                controller->setInstrument(voice, controller->GetMelodicDefault(voice % 6).data());
+                controller->playNoteDOS(voice, 13 + voice % 60);
+            }
+            controller->start_song(*sd, true);
+
+            std::vector<int16_t> s16((size_t)blockFrames * 2);
+            results.push_back(runBench(name, opt, [&]() {
+                for (int i = 0; i < blocksPerOp; i++)
+                    controller->fillBuffer(s16.data(), blockFrames);
+            }, (uint64_t)blockFrames * blocksPerOp));
+        }
+    }
+}
+//------------------------------------------------------------------------------
+static void benchSequencer(const BenchOptions& opt, std::vector<BenchResult>& results)
+{
+    if (std::string("sequencer/dense").find(opt.filter) == std::string::npos)
+        return;
+
+    auto controller = std::make_unique<OplController>();
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    buildDenseSong(*sd);
+    controller->start_song(*sd, true);
+
+    const int ticksPerOp = 100;
+    BenchResult result = runBench("sequencer/dense", opt, [&]() {
+        for (int i = 0; i < ticksPerOp; i++)
+            controller->tickSequencer();
+    });
+    result.nsPerOp /= ticksPerOp; // per tick = one row of 9 notes
+    result.nsPerOpBest /= ticksPerOp;
+    result.allocsPerOp /= ticksPerOp;
+    results.push_back(result);
+}
+//------------------------------------------------------------------------------
+static void benchInstrument(const BenchOptions& opt, std::vector<BenchResult>& results)
+{
+    if (std::string("instrument/set").find(opt.filter) == std::string::npos)
+        return;
+
+    auto controller = std::make_unique<OplController>();
+    std::array<uint8_t, 24> instruments[FMS_MAX_CHANNEL + 1];
+    for (uint8_t ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++)
+        instruments[ch] = controller->GetMelodicDefault(ch);
+
+    BenchResult result = runBench("instrument/set", opt, [&]() {
+        for (uint8_t ch = FMS_MIN_CHANNEL; ch <= FMS_MAX_CHANNEL; ch++)
+            controller->setInstrument(ch, instruments[ch].data());
+    });
+    const int perOp = FMS_MAX_CHANNEL + 1;
+    result.nsPerOp /= perOp;
+    result.nsPerOpBest /= perOp;
+    result.allocsPerOp /= perOp;
+    results.push_back(result);
+}
+//------------------------------------------------------------------------------
+static void benchNotes(const BenchOptions& opt, std::vector<BenchResult>& results)
+{
+    // the composer shows about this many rows, every cell holds a note
+    const int visibleRows = 64;
+    const int channels = FMS_MAX_CHANNEL + 1;
+    int16_t frame[visibleRows][channels];
+    for (int row = 0; row < visibleRows; row++)
+        for (int ch = 0; ch < channels; ch++)
+            frame[row][ch] = (int16_t)(1 + (row * channels + ch) % (OplNoteTable::DOS_NOTES - 1));
+
+    size_t checksum = 0; // keeps the loops
+    if (std::string("notes/frame").find(opt.filter) != std::string::npos) {
+        results.push_back(runBench("notes/frame", opt, [&]() {
+            for (int row = 0; row < visibleRows; row++)
+                for (int ch = 0; ch < channels; ch++)
+                    checksum += OplController::getNoteNameFromId(frame[row][ch])[0];
+        }));
+    }
+    if (std::string("notes/parse").find(opt.filter) != std::string::npos) {
+        const int perOp = OplNoteTable::DOS_NOTES;
+        BenchResult result = runBench("notes/parse", opt, [&]() {
+            for (int id = 0; id < perOp; id++)
+                checksum += OplController::getIdFromNoteName(OplNoteTable::NAMES[id].data());
+        });
+        result.nsPerOp /= perOp;
+        result.nsPerOpBest /= perOp;
+        result.allocsPerOp /= perOp;
+        results.push_back(result);
+    }
+    if (checksum == 1)
+        std::printf(" ");
+}
+//------------------------------------------------------------------------------
+static void benchFiles(const BenchOptions& opt, const fs::path& songFile,
+                       const fs::path& tempDir, std::vector<BenchResult>& results)
+{
+    auto controller = std::make_unique<OplController>();
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    sd->init();
+
+    if (std::string("file/load").find(opt.filter) != std::string::npos) {
+        results.push_back(runBench("file/load", opt, [&]() {
+            controller->loadSongFMS(songFile.string(), *sd);
+        }));
+    }
+    if (std::string("file/save").find(opt.filter) != std::string::npos) {
+        controller->loadSongFMS(songFile.string(), *sd);
+        const std::string saveFile = (tempDir / "fmsbench_save.fms").string();
+        results.push_back(runBench("file/save", opt, [&]() {
+            controller->saveSongFMS(saveFile, *sd);
+        }));
+    }
+}
+//------------------------------------------------------------------------------
+static void benchExport(const BenchOptions& opt, const std::vector<fs::path>& songs,
+                        const fs::path& tempDir, std::vector<BenchResult>& results)
+{
+    BenchOptions once = opt;
+    once.minTime = 0.0; // whole songs, three runs each are enough
+
+    for (const fs::path& songFile : songs) {
+        std::string name = "export/" + songFile.stem().string();
+        if (name.find(opt.filter) == std::string::npos)
+            continue;
+
+        auto controller = std::make_unique<OplController>();
+        auto sd = std::make_unique<OplController::SongDataFMS>();
+        sd->init();
+        if (!controller->loadSongFMS(songFile.string(), *sd))
+            continue;
+
+        const std::string wavFile = (tempDir / "fmsbench_export.wav").string();
+        uint64_t frames = 0;
+        BenchResult result = runBench(name, once, [&]() {
+            auto engine = controller->cloneOffline();
+            engine->renderToWav(*sd, wavFile);
+            frames = engine->getRenderedFrames();
+        });
+        if (frames > 0) {
+            result.nsPerSample = result.nsPerOp / (double)frames;
+            result.realtimeFactor = ((double)frames / (double)OplOutputSpec::DEFAULT_RATE) / (result.nsPerOp / 1e9);
+        }
+        results.push_back(result);
+    }
+}
+//------------------------------------------------------------------------------
+static bool writeJson(const std::string& filename, const std::vector<BenchResult>& results)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        std::fprintf(file,
+            "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, \"ns_per_op_best\": %.1f, "
+            "\"ns_per_sample\": %.3f, \"realtime_factor\": %.1f, \"allocs_per_op\": %.2f }%s\n",
+            r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.nsPerOpBest,
+            r.nsPerSample, r.realtimeFactor, r.allocsPerOp, (i + 1 < results.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+//------------------------------------------------------------------------------
+static bool writeCsv(const std::string& filename, const std::vector<BenchResult>& results)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "name,iterations,ns_per_op,ns_per_op_best,ns_per_sample,realtime_factor,allocs_per_op\n");
+    for (const BenchResult& r : results) {
+        std::fprintf(file, "%s,%llu,%.1f,%.1f,%.3f,%.1f,%.2f\n",
+            r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.nsPerOpBest,
+            r.nsPerSample, r.realtimeFactor, r.allocsPerOp);
+    }
+    return std::fclose(file) == 0;
+}
+//------------------------------------------------------------------------------
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: fmsbench [options]\n"
+        "  --songs <dir>        song directory (default pascal/ADLIB)\n"
+        "  --filter <text>      only benchmarks whose name contains text\n"
+        "  --min-time <sec>     time per benchmark (default 0.25)\n"
+        "  --no-export          skip the export of every song\n"
+        "  --json <file>        write the results as json\n"
+        "  --csv <file>         write the results as csv\n");
+}
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--songs" && hasValue)
+            opt.songDir = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            opt.filter = argv[++i];
+        else if (arg == "--min-time" && hasValue)
+            opt.minTime = std::atof(argv[++i]);
+        else if (arg == "--no-export")
+            opt.exportSongs = false;
+        else if (arg == "--json" && hasValue)
+            opt.jsonFile = argv[++i];
+        else if (arg == "--csv" && hasValue)
+            opt.csvFile = argv[++i];
+        else {
+            printUsage();
+            return (arg == "-h" || arg == "--help") ? 0 : 2;
+        }
+    }
+
+    std::vector<fs::path> songs = findSongs(opt.songDir);
+    if (songs.empty()) {
+        Log("ERROR: no .fms songs in %s", opt.songDir.c_str());
+        return 1;
+    }
+    // the render benchmarks loop the first song
+    const fs::path& renderSong = songs.front();
+    const fs::path tempDir = fs::temp_directory_path();
+
+    gOplLogQuiet = true; // loadSongFMS logs every load
+    std::vector<BenchResult> results;
+    benchRender(opt, renderSong, results);
+    benchChips(opt, renderSong, results);
+    benchSequencer(opt, results);
+    benchInstrument(opt, results);
+    benchNotes(opt, results);
+    benchFiles(opt, renderSong, tempDir, results);
+    if (opt.exportSongs)
+        benchExport(opt, songs, tempDir, results);
+    gOplLogQuiet = false;
+
+    std::error_code ec;
+    fs::remove(tempDir / "fmsbench_save.fms", ec);
+    fs::remove(tempDir / "fmsbench_export.wav", ec);
+
+    std::printf("%-24s %10s %14s %12s %10s %10s\n",
+                "benchmark", "iter", "ns/op", "ns/sample", "x realtime", "allocs/op");
+    for (const BenchResult& r : results) {
+        std::printf("%-24s %10llu %14.1f %12.3f %10.1f %10.2f\n",
+                    r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp,
+                    r.nsPerSample, r.realtimeFactor, r.allocsPerOp);
+    }
+
+    bool ok = true;
+    if (!opt.jsonFile.empty() && !writeJson(opt.jsonFile, results)) {
+        Log("ERROR: Failed to write %s", opt.jsonFile.c_str());
+        ok = false;
+    }
+    if (!opt.csvFile.empty() && !writeCsv(opt.csvFile, results)) {
+        Log("ERROR: Failed to write %s", opt.csvFile.c_str());
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// fmsgolden: golden audio regression check of the render output.
+// Renders every .fms of the song directory in every RenderMode (S16, 44100)
+// and compares it against a recorded manifest of hashes. With a reference
+// PCM directory a mismatch is compared sample by sample within a tolerance
+// and the first divergent sample is reported.
+//
+//   fmsgolden record golden.txt --pcm golden/     before the change
+//   fmsgolden check  golden.txt --pcm golden/ --tolerance 1
+//
+// manifest line: <song> <mode> <frames> <fnv1a64 hash>
+//-----------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OplController.h"
+
+namespace fs = std::filesystem;
+
+static const struct {
+    const char* name;
+    OplController::RenderMode mode;
+} sModes[] = {
+    { "raw",       OplController::RenderMode::RAW },
+    { "blended",   OplController::RenderMode::BLENDED },
+    { "modernlpf", OplController::RenderMode::MODERN_LPF },
+    { "sbpro",     OplController::RenderMode::SBPRO },
+    { "sb",        OplController::RenderMode::SB_ORIGINAL },
+    { "adlibgold", OplController::RenderMode::ADLIB_GOLD },
+    { "clone",     OplController::RenderMode::CLONE_CARD },
+    { "sinc",      OplController::RenderMode::SINC },
+};
+
+struct GoldenEntry {
+    uint64_t frames = 0;
+    uint64_t hash = 0;
+};
+
+struct GoldenOptions {
+    bool record = false;
+    std::string manifest;
+    std::string songDir = "pascal/ADLIB";
+    std::string pcmDir;     // reference PCM, optional
+    int tolerance = 0;      // max abs difference in LSB
+};
+
+//------------------------------------------------------------------------------
+static uint64_t fnv1a64(const void* data, size_t bytes, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+//------------------------------------------------------------------------------
+static std::vector<fs::path> findSongs(const std::string& dir)
+{
+    std::vector<fs::path> songs;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (entry.is_regular_file() && ext == ".fms")
+            songs.push_back(entry.path());
+    }
+    std::sort(songs.begin(), songs.end());
+    return songs;
+}
+//------------------------------------------------------------------------------
+// same length as the wav export: one tick per row
+static bool renderSong(const fs::path& songFile, OplController::RenderMode mode, std::vector<int16_t>& pcm)
+{
+    auto controller = std::make_unique<OplController>();
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    sd->init();
+    controller->setRenderMode(mode);
+    gOplLogQuiet = true; // loadSongFMS logs every load
+    const bool loaded = controller->loadSongFMS(songFile.string(), *sd);
+    gOplLogQuiet = false;
+    if (!loaded)
+        return false;
+
+    controller->start_song(*sd, false, 0, -1);
+    const uint64_t totalFrames = (uint64_t)sd->song_length * controller->getSequencerState().samples_per_tick;
+    pcm.assign(totalFrames * OplOutputSpec::CHANNELS, 0);
+
+    const int chunkFrames = 4096;
+    for (uint64_t done = 0; done < totalFrames; done += chunkFrames) {
+        int frames = (int)std::min<uint64_t>(chunkFrames, totalFrames - done);
+        controller->fillBuffer(pcm.data() + done * OplOutputSpec::CHANNELS, frames);
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+static fs::path pcmPath(const GoldenOptions& opt, const std::string& key)
+{
+    return fs::path(opt.pcmDir) / (key + ".s16");
+}
+//------------------------------------------------------------------------------
+static bool loadPcm(const fs::path& file, std::vector<int16_t>& pcm)
+{
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+        return false;
+    std::streamsize bytes = in.tellg();
+    in.seekg(0);
+    pcm.resize((size_t)bytes / sizeof(int16_t));
+    return (bool)in.read(reinterpret_cast<char*>(pcm.data()), (std::streamsize)(pcm.size() * sizeof(int16_t)));
+}
+//------------------------------------------------------------------------------
+static bool savePcm(const fs::path& file, const std::vector<int16_t>& pcm)
+{
+    std::ofstream out(file, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(pcm.data()), (std::streamsize)(pcm.size() * sizeof(int16_t)));
+    return out.good();
+}
+//------------------------------------------------------------------------------
+static bool loadManifest(const std::string& filename, std::map<std::string, GoldenEntry>& entries)
+{
+    std::ifstream in(filename);
+    if (!in.is_open())
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string song, mode, hash;
+        GoldenEntry entry;
+        if (!(fields >> song >> mode >> entry.frames >> hash))
+            continue;
+        entry.hash = std::strtoull(hash.c_str(), nullptr, 16);
+        entries[song + "." + mode] = entry;
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+// reports the first sample differing by more than the tolerance,
+// returns true if everything is within it
+static bool comparePcm(const std::string& key, const std::vector<int16_t>& expected,
+                       const std::vector<int16_t>& actual, int tolerance)
+{
+    const size_t common = std::min(expected.size(), actual.size());
+    int maxDiff = 0;
+    size_t firstBad = SIZE_MAX;
+    for (size_t i = 0; i < common; i++) {
+        int diff = std::abs((int)expected[i] - (int)actual[i]);
+        maxDiff = std::max(maxDiff, diff);
+        if (diff > tolerance && firstBad == SIZE_MAX)
+            firstBad = i;
+    }
+
+    if (firstBad != SIZE_MAX) {
+        const size_t frame = firstBad / OplOutputSpec::CHANNELS;
+        std::printf("FAIL %-22s first divergent sample: frame %zu (%.3f s) %s, expected %d got %d, max diff %d\n",
+                    key.c_str(), frame, (double)frame / OplOutputSpec::DEFAULT_RATE,
+                    (firstBad % 2) ? "right" : "left", expected[firstBad], actual[firstBad], maxDiff);
+        return false;
+    }
+    if (expected.size() != actual.size()) {
+        std::printf("FAIL %-22s length %zu frames, expected %zu\n", key.c_str(),
+                    actual.size() / OplOutputSpec::CHANNELS, expected.size() / OplOutputSpec::CHANNELS);
+        return false;
+    }
+    std::printf("OK   %-22s within tolerance (max diff %d)\n", key.c_str(), maxDiff);
+    return true;
+}
+//------------------------------------------------------------------------------
+static int record(const GoldenOptions& opt, const std::vector<fs::path>& songs)
+{
+    std::FILE* file = std::fopen(opt.manifest.c_str(), "w");
+    if (!file) {
+        Log("ERROR: Failed to write %s", opt.manifest.c_str());
+        return 1;
+    }
+    if (!opt.pcmDir.empty())
+        fs::create_directories(opt.pcmDir);
+
+    std::fprintf(file, "# fmsgolden manifest: song mode frames fnv1a64 (S16 stereo %d Hz)\n",
+                 OplOutputSpec::DEFAULT_RATE);
+    int failed = 0;
+    std::vector<int16_t> pcm;
+    for (const fs::path& song : songs) {
+        for (const auto& mode : sModes) {
+            const std::string key = song.stem().string() + "." + mode.name;
+            if (!renderSong(song, mode.mode, pcm)) {
+                std::printf("FAIL %-22s could not render\n", key.c_str());
+                failed++;
+                continue;
+            }
+            const uint64_t hash = fnv1a64(pcm.data(), pcm.size() * sizeof(int16_t));
+            std::fprintf(file, "%s %s %zu %016llx\n", song.stem().string().c_str(), mode.name,
+                         pcm.size() / OplOutputSpec::CHANNELS, (unsigned long long)hash);
+            if (!opt.pcmDir.empty() && !savePcm(pcmPath(opt, key), pcm)) {
+                std::printf("FAIL %-22s could not write reference pcm\n", key.c_str());
+                failed++;
+            }
+        }
+    }
+    std::fclose(file);
+    std::printf("recorded %zu songs x %zu modes to %s\n", songs.size(), std::size(sModes), opt.manifest.c_str());
+    return failed ? 1 : 0;
+}
+//------------------------------------------------------------------------------
+static int check(const GoldenOptions& opt, const std::vector<fs::path>& songs)
+{
+    std::map<std::string, GoldenEntry> entries;
+    if (!loadManifest(opt.manifest, entries)) {
+        Log("ERROR: Failed to read %s", opt.manifest.c_str());
+        return 1;
+    }
+
+    int passed = 0, failed = 0, missing = 0;
+    std::vector<int16_t> pcm, reference;
+    for (const fs::path& song : songs) {
+        for (const auto& mode : sModes) {
+            const std::string key = song.stem().string() + "." + mode.name;
+            auto it = entries.find(key);
+            if (it == entries.end()) {
+                std::printf("NEW  %-22s not in the manifest\n", key.c_str());
+                missing++;
+                continue;
+            }
+            if (!renderSong(song, mode.mode, pcm)) {
+                std::printf("FAIL %-22s could not render\n", key.c_str());
+                failed++;
+                continue;
+            }
+
+            const uint64_t hash = fnv1a64(pcm.data(), pcm.size() * sizeof(int16_t));
+            const uint64_t frames = pcm.size() / OplOutputSpec::CHANNELS;
+            if (hash == it->second.hash && frames == it->second.frames) {
+                passed++;
+                continue;
+            }
+
+            if (!opt.pcmDir.empty() && loadPcm(pcmPath(opt, key), reference)) {
+                if (comparePcm(key, reference, pcm, opt.tolerance))
+                    passed++;
+                else
+                    failed++;
+            } else {
+                std::printf("FAIL %-22s hash %016llx, expected %016llx (no reference pcm)\n",
+                            key.c_str(), (unsigned long long)hash, (unsigned long long)it->second.hash);
+                failed++;
+            }
+        }
+    }
+
+    std::printf("%d passed, %d failed, %d not in the manifest\n", passed, failed, missing);
+    return failed ? 1 : 0;
+}
+//------------------------------------------------------------------------------
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: fmsgolden record|check <manifest> [options]\n"
+        "  --songs <dir>        song directory (default pascal/ADLIB)\n"
+        "  --pcm <dir>          reference PCM (record writes it, check compares with it)\n"
+        "  --tolerance <lsb>    allowed difference per sample when comparing PCM (default 0)\n");
+}
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        printUsage();
+        return 2;
+    }
+
+    GoldenOptions opt;
+    const std::string command = argv[1];
+    if (command != "record" && command != "check") {
+        printUsage();
+        return 2;
+    }
+    opt.record = (command == "record");
+    opt.manifest = argv[2];
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--songs" && hasValue)
+            opt.songDir = argv[++i];
+        else if (arg == "--pcm" && hasValue)
+            opt.pcmDir = argv[++i];
+        else if (arg == "--tolerance" && hasValue)
+            opt.tolerance = std::max(0, std::atoi(argv[++i]));
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::vector<fs::path> songs = findSongs(opt.songDir);
+    if (songs.empty()) {
+        Log("ERROR: no .fms songs in %s", opt.songDir.c_str());
+        return 1;
+    }
+
+    return opt.record ? record(opt, songs) : check(opt, songs);
+}
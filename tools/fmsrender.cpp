@@ -0,0 +1,353 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2026 Ohmtal Game Studio
+// SPDX-License-Identifier: MIT
+//-----------------------------------------------------------------------------
+// fmsrender: headless renderer for .fms songs and .fmi instruments.
+// Built from lib/opl only, no window, no GPU and no audio device.
+//
+//   fmsrender song.fms -o song.wav
+//   fmsrender song.fms -o - -f f32 -r 48000 | aplay -f FLOAT_LE -c 2 -r 48000
+//   fmsrender -d out/ pascal/ADLIB/*.FMS -j 8
+//   fmsrender BELL.FMI -o bell.wav          (plays a scale on the instrument)
+//
+// Log output goes to stderr, stdout only carries PCM with "-o -".
+//-----------------------------------------------------------------------------
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "OplController.h"
+#include "OplBatchRenderer.h"
+
+namespace fs = std::filesystem;
+
+//------------------------------------------------------------------------------
+struct RenderOptions {
+    std::vector<std::string> inputs;
+    std::string output;            // file or "-" for raw PCM on stdout
+    std::string outDir;            // batch: one wav per input
+    OplOutputSpec spec;
+    OplController::RenderMode mode = OplController::RenderMode::BLENDED;
+    bool melodicMode = true;
+    OplTuning tuning;
+    uint32_t threads = 0;
+    std::vector<std::pair<uint8_t, std::string>> instruments; // channel, .fmi
+};
+
+struct ModeName {
+    const char* name;
+    OplController::RenderMode mode;
+};
+
+struct TuningName {
+    const char* name;
+    OplTuning tuning;
+};
+
+static const TuningName sTuningNames[] = {
+    { "standard",  OplNoteTable::STANDARD },
+    { "a432",      OplNoteTable::A432 },
+    { "stretched", OplNoteTable::STRETCHED },
+};
+
+static const ModeName sModeNames[] = {
+    { "raw",       OplController::RenderMode::RAW },
+    { "blended",   OplController::RenderMode::BLENDED },
+    { "modernlpf", OplController::RenderMode::MODERN_LPF },
+    { "sbpro",     OplController::RenderMode::SBPRO },
+    { "sb",        OplController::RenderMode::SB_ORIGINAL },
+    { "adlibgold", OplController::RenderMode::ADLIB_GOLD },
+    { "clone",     OplController::RenderMode::CLONE_CARD },
+    { "sinc",      OplController::RenderMode::SINC },
+};
+
+//------------------------------------------------------------------------------
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: fmsrender [options] <song.fms | instrument.fmi> ...\n"
+        "  -o, --output <file>      wav file, \"-\" writes raw interleaved PCM to stdout\n"
+        "  -d, --outdir <dir>       render every input to <dir>/<name>.wav\n"
+        "  -r, --rate <hz>          output rate (%d..%d, default %d)\n"
+        "  -f, --format <s16|f32>   sample format (default s16)\n"
+        "  -m, --mode <mode>        raw, blended, modernlpf, sbpro, sb, adlibgold,\n"
+        "                           clone, sinc (default blended)\n"
+        "  -i, --instrument <ch=file.fmi>  override the instrument of channel 1..9 (1..18 for .fm3)\n"
+        "      --rhythm             render in rhythm mode instead of melodic mode\n"
+        "  -t, --tuning <tuning>    standard, a432, stretched (default standard)\n"
+        "      --detune <cents>     shift every note\n"
+        "  -j, --jobs <n>           worker threads for --outdir (default: cores)\n"
+        "  -q, --quiet              no log output\n"
+        "  -h, --help\n",
+        OplOutputSpec::MIN_RATE, OplOutputSpec::MAX_RATE, OplOutputSpec::DEFAULT_RATE);
+}
+//------------------------------------------------------------------------------
+static std::string toLower(std::string value)
+{
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return (char)std::tolower(c); });
+    return value;
+}
+//------------------------------------------------------------------------------
+static bool isInstrumentFile(const std::string& filename)
+{
+    return toLower(fs::path(filename).extension().string()) == ".fmi";
+}
+//------------------------------------------------------------------------------
+static bool parseArgs(int argc, char** argv, RenderOptions& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char* what) -> const char* {
+            if (i + 1 >= argc) {
+                Log("ERROR: %s needs a value", what);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            std::exit(0);
+        } else if (arg == "-o" || arg == "--output") {
+            const char* v = value("--output");
+            if (!v) return false;
+            opt.output = v;
+        } else if (arg == "-d" || arg == "--outdir") {
+            const char* v = value("--outdir");
+            if (!v) return false;
+            opt.outDir = v;
+        } else if (arg == "-r" || arg == "--rate") {
+            const char* v = value("--rate");
+            if (!v) return false;
+            opt.spec.rate = std::atoi(v);
+        } else if (arg == "-f" || arg == "--format") {
+            const char* v = value("--format");
+            if (!v) return false;
+            std::string format = toLower(v);
+            if (format == "s16")
+                opt.spec.format = OplOutputSpec::Format::S16;
+            else if (format == "f32")
+                opt.spec.format = OplOutputSpec::Format::F32;
+            else {
+                Log("ERROR: unknown format %s", v);
+                return false;
+            }
+        } else if (arg == "-m" || arg == "--mode") {
+            const char* v = value("--mode");
+            if (!v) return false;
+            std::string mode = toLower(v);
+            auto it = std::find_if(std::begin(sModeNames), std::end(sModeNames),
+                                   [&](const ModeName& m) { return mode == m.name; });
+            if (it == std::end(sModeNames)) {
+                Log("ERROR: unknown render mode %s", v);
+                return false;
+            }
+            opt.mode = it->mode;
+        } else if (arg == "-i" || arg == "--instrument") {
+            const char* v = value("--instrument");
+            if (!v) return false;
+            const char* sep = std::strchr(v, '=');
+            int channel = sep ? std::atoi(v) : 0;
+            if (!sep || channel < FMS_MIN_CHANNEL + 1 || channel > FMS_OPL3_MAX_CHANNEL + 1) {
+                Log("ERROR: --instrument expects <1..18>=<file.fmi>, got %s", v);
+                return false;
+            }
+            opt.instruments.emplace_back((uint8_t)(channel - 1), std::string(sep + 1));
+        } else if (arg == "--rhythm") {
+            opt.melodicMode = false;
+        } else if (arg == "-t" || arg == "--tuning") {
+            const char* v = value("--tuning");
+            if (!v) return false;
+            auto it = std::find_if(std::begin(sTuningNames), std::end(sTuningNames),
+                                   [&](const TuningName& t) { return toLower(v) == t.name; });
+            if (it == std::end(sTuningNames)) {
+                Log("ERROR: unknown tuning %s", v);
+                return false;
+            }
+            const double detune = opt.tuning.detuneCents;
+            opt.tuning = it->tuning;
+            opt.tuning.detuneCents = detune;
+        } else if (arg == "--detune") {
+            const char* v = value("--detune");
+            if (!v) return false;
+            opt.tuning.detuneCents = std::atof(v);
+        } else if (arg == "-j" || arg == "--jobs") {
+            const char* v = value("--jobs");
+            if (!v) return false;
+            opt.threads = (uint32_t)std::max(0, std::atoi(v));
+        } else if (arg == "-q" || arg == "--quiet") {
+            gOplLogQuiet = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            Log("ERROR: unknown option %s", arg.c_str());
+            return false;
+        } else {
+            opt.inputs.push_back(arg);
+        }
+    }
+
+    if (opt.inputs.empty()) {
+        printUsage();
+        return false;
+    }
+    if (!opt.spec.isValid()) {
+        Log("ERROR: rate %d is out of range", opt.spec.rate);
+        return false;
+    }
+    if (opt.outDir.empty() && opt.output.empty()) {
+        Log("ERROR: no output, use -o <file|-> or -d <dir>");
+        return false;
+    }
+    if (opt.outDir.empty() && opt.inputs.size() > 1) {
+        Log("ERROR: several inputs need --outdir");
+        return false;
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+// a short scale on channel 1 to listen to an instrument
+static void buildInstrumentPreview(OplController& controller, OplController::SongDataFMS& sd)
+{
+    static const char* scale[] = { "C-4", "D-4", "E-4", "F-4", "G-4", "A-4", "B-4", "C-5" };
+    const int rowsPerNote = 4;
+
+    sd.init();
+    sd.song_delay = 6;
+    int row = 0;
+    for (const char* note : scale) {
+        sd.setNote(row, FMS_MIN_CHANNEL, (int16_t)controller.getIdFromNoteName(note));
+        row += rowsPerNote;
+    }
+    sd.setNote(row, FMS_MIN_CHANNEL, -1);
+    sd.song_length = (uint16_t)(row + rowsPerNote * 2); // let the release ring out
+}
+//------------------------------------------------------------------------------
+static bool prepareController(OplController& controller, const RenderOptions& opt,
+                              const std::string& input, OplController::SongDataFMS& sd)
+{
+    controller.setRenderMode(opt.mode);
+    controller.setTuning(opt.tuning);
+    if (!controller.setOutputSpec(opt.spec))
+        return false;
+
+    if (isInstrumentFile(input)) {
+        controller.reset();
+        if (!controller.loadInstrument(input, FMS_MIN_CHANNEL)) {
+            Log("ERROR: Failed to load instrument %s", input.c_str());
+            return false;
+        }
+        buildInstrumentPreview(controller, sd);
+    } else {
+        sd.init();
+        // loading resets the chip, everything else is set afterwards
+        if (!controller.loadSongFMS(input, sd))
+            return false;
+    }
+
+    controller.setMelodicMode(opt.melodicMode);
+    for (const auto& [channel, file] : opt.instruments) {
+        if (!controller.loadInstrument(file, channel)) {
+            Log("ERROR: Failed to load instrument %s", file.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+static bool renderToStdout(OplController& controller, OplController::SongDataFMS& sd)
+{
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    const OplOutputSpec spec = controller.getOutputSpec();
+    controller.start_song(sd, false, 0, -1);
+    controller.setPos(0);
+
+    // same length as renderToWav: one tick per row
+    const uint64_t totalFrames = (uint64_t)sd.song_length * controller.getSequencerState().samples_per_tick;
+    const int chunkFrames = 4096;
+    std::vector<uint8_t> buffer((size_t)chunkFrames * spec.bytesPerFrame());
+
+    uint64_t done = 0;
+    while (done < totalFrames) {
+        int frames = (int)std::min<uint64_t>(chunkFrames, totalFrames - done);
+        if (spec.format == OplOutputSpec::Format::F32)
+            controller.fillBuffer(reinterpret_cast<float*>(buffer.data()), frames);
+        else
+            controller.fillBuffer(reinterpret_cast<int16_t*>(buffer.data()), frames);
+
+        size_t bytes = (size_t)frames * spec.bytesPerFrame();
+        if (std::fwrite(buffer.data(), 1, bytes, stdout) != bytes) {
+            Log("ERROR: Failed writing to stdout");
+            return false;
+        }
+        done += frames;
+    }
+    return std::fflush(stdout) == 0;
+}
+//------------------------------------------------------------------------------
+static int renderBatch(const RenderOptions& opt)
+{
+    std::error_code ec;
+    fs::create_directories(opt.outDir, ec);
+    if (ec) {
+        Log("ERROR: Failed to create %s: %s", opt.outDir.c_str(), ec.message().c_str());
+        return 1;
+    }
+
+    // the batch renderer only knows songs with their own instruments
+    if (!opt.instruments.empty())
+        Log("WARNING: --instrument is ignored with --outdir");
+
+    OplBatchRenderer batch;
+    for (const std::string& input : opt.inputs) {
+        if (isInstrumentFile(input)) {
+            Log("WARNING: skipping instrument %s in batch mode", input.c_str());
+            continue;
+        }
+        fs::path wav = fs::path(opt.outDir) / fs::path(input).filename().replace_extension(".wav");
+        batch.addJob(input, wav.string());
+    }
+
+    OplBatchRenderer::Settings settings;
+    settings.renderMode = opt.mode;
+    settings.spec = opt.spec;
+    settings.melodicMode = opt.melodicMode;
+    settings.tuning = opt.tuning;
+    settings.threads = opt.threads;
+    if (!batch.start(settings))
+        return 1;
+    return batch.wait() ? 0 : 1;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    RenderOptions opt;
+    if (!parseArgs(argc, argv, opt))
+        return 2;
+
+    if (!opt.outDir.empty())
+        return renderBatch(opt);
+
+    const std::string& input = opt.inputs.front();
+    auto controller = std::make_unique<OplController>();
+    auto sd = std::make_unique<OplController::SongDataFMS>();
+    if (!prepareController(*controller, opt, input, *sd))
+        return 1;
+
+    bool ok = (opt.output == "-")
+        ? renderToStdout(*controller, *sd)
+        : controller->renderToWav(*sd, opt.output);
+    return ok ? 0 : 1;
+}